@@ -98,6 +98,11 @@ void IniConfig::clear() {
     audio_s.frequency = SidConfig::DEFAULT_SAMPLING_FREQ;
     audio_s.channels  = 0;
     audio_s.precision = 16;
+    audio_s.queueDepth = 4;
+    audio_s.device.clear();
+    audio_s.periodSize = 0;
+    audio_s.periods    = 0;
+    audio_s.bufferTime = 0;
 
     emulation_s.modelDefault    = SidConfig::PAL;
     emulation_s.modelForced     = false;
@@ -317,6 +322,12 @@ void IniConfig::readAudio(iniHandler &ini) {
     readInt(ini, TEXT("Sample rate"), audio_s.frequency);
     readInt(ini, TEXT("Channels"), audio_s.channels);
     readInt(ini, TEXT("Bit depth"), audio_s.precision);
+    readInt(ini, TEXT("Queue depth"), audio_s.queueDepth);
+
+    audio_s.device = readString(ini, TEXT("Device"));
+    readInt(ini, TEXT("Period size"), audio_s.periodSize);
+    readInt(ini, TEXT("Periods"), audio_s.periods);
+    readInt(ini, TEXT("Buffer time"), audio_s.bufferTime);
 }
 
 void IniConfig::readEmulation(iniHandler &ini) {
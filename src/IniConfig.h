@@ -63,6 +63,11 @@ public:
         int frequency;
         int channels;
         int precision;
+        int queueDepth; // blocks, 0 = write directly
+        SID_STRING device;
+        int periodSize; // frames
+        int periods;
+        int bufferTime; // ms
     };
 
     struct emulation_section { // [Emulation] section
@@ -22,13 +22,17 @@
 
 #include "player.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <cstring>
+#include <cerrno>
 #include <climits>
 #include <cstdlib>
 
 #include "ini/types.h"
+#include "utils.h"
+#include "fileutils.h"
 
 #include "sidlib_features.h"
 
@@ -50,6 +54,13 @@ using std::endl;
 #undef  SEPARATOR
 #define SEPARATOR "/"
 
+// Written by --find-lengths, in the format with milliseconds if supported
+#ifdef FEAT_NEW_SONLEGTH_DB
+#  define LOCAL_SONGLENGTHS "Songlengths.md5"
+#else
+#  define LOCAL_SONGLENGTHS "Songlengths.txt"
+#endif
+
 /**
  * Try load SID tune from HVSC_BASE
  */
@@ -73,7 +84,24 @@ bool ConsolePlayer::tryOpenDatabase(const char *hvscBase, const char *suffix) {
     std::string newFileName(hvscBase);
 
     newFileName.append(SEPARATOR).append("DOCUMENTS").append(SEPARATOR).append("Songlengths.").append(suffix);
-    return m_database.open(newFileName.c_str());
+    return openDatabase(newFileName.c_str());
+}
+
+/**
+ * Open a songlength DB through the compiled index,
+ * falling back to the library parser
+ */
+bool ConsolePlayer::openDatabase(const char *database) {
+#if !defined(_WIN32) || !defined(UNICODE)
+    try {
+        std::string cacheDir(utils::getDataPath());
+        cacheDir.append(SEPARATOR).append("sidplayfp");
+        if (m_songlengths.open(database, cacheDir))
+            return true;
+    }
+    catch (utils::error const &e) {}
+#endif
+    return m_database.open(database);
 }
 
 // Convert time from integer
@@ -124,6 +152,21 @@ bool parseTime(const char *str, uint_least32_t &time) {
     return true;
 }
 
+// Convert a positive decimal number, rejecting anything else
+bool parseCount(const char *str, uint_least32_t &count) {
+    if ((*str < '0') || (*str > '9'))
+        return false;
+
+    char *end;
+    errno = 0;
+    const unsigned long val = strtoul(str, &end, 10);
+    if ((*end != '\0') || (errno == ERANGE) || (val == 0) || (val > 0xffffffffUL))
+        return false;
+
+    count = (uint_least32_t) val;
+    return true;
+}
+
 bool parseAddress(const char *str, uint_least16_t &address) {
     if (*str == '\0')
         return false;
@@ -156,6 +199,9 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
     m_driver.output = OUT_SOUNDCARD;
     m_driver.file   = false;
     m_driver.info   = false;
+    m_driver.loudness = false;
+    m_driver.monitor = false;
+    m_driver.multichannel = false;
 
     for (int i=0; i < 9; i++) {
         vMute[i] = false;
@@ -164,6 +210,7 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
     int     infile = 0;
     uint8_t i      = 0;
     bool    err    = false;
+    bool    findLengths = false;
 
     // parse command line arguments
     while ((i < argc) && (argv[i] != nullptr)) {
@@ -227,7 +274,7 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
                     err = true;
                 {
                     uint_least8_t precision = atoi(&argv[i][2]);
-                    m_precision = ((precision <= 16) ? 16 : 32);
+                    m_precision = ((precision <= 16) ? 16 : (precision <= 24) ? 24 : 32);
                 }
             }
 
@@ -317,9 +364,137 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
                 if (argv[i][4] != '\0')
                     m_outfile = &argv[i][4];
             }
+            else if (strncmp (&argv[i][1], "-raw", 4) == 0) {
+                m_driver.output = OUT_RAW;
+                m_driver.file   = true;
+                if (argv[i][5] != '\0')
+                    m_outfile = &argv[i][5];
+            }
+#ifdef HAVE_FLAC
+            else if (strncmp (&argv[i][1], "-flac", 5) == 0) {
+                m_driver.output = OUT_FLAC;
+                m_driver.file   = true;
+                if (argv[i][6] != '\0')
+                    m_outfile = &argv[i][6];
+            }
+#endif
+#ifdef HAVE_OPUSENC
+            else if (strncmp (&argv[i][1], "-opus", 5) == 0) {
+                m_driver.output = OUT_OPUS;
+                m_driver.file   = true;
+                if (argv[i][6] != '\0')
+                    m_outfile = &argv[i][6];
+            }
+#endif
             else if (strncmp (&argv[i][1], "-info", 5) == 0) {
                 m_driver.info   = true;
             }
+            else if (strcmp (&argv[i][1], "-loudness") == 0) {
+                m_driver.loudness = true;
+            }
+            else if (strcmp (&argv[i][1], "-tee") == 0) {
+                m_driver.monitor = true;
+            }
+            else if (strcmp (&argv[i][1], "-multichannel") == 0) {
+                m_driver.multichannel = true;
+            }
+
+            // Soundcard settings
+            else if (strncmp (&argv[i][1], "-device=", 8) == 0) {
+                if (argv[i][9] == '\0')
+                    err = true;
+                m_driver.deviceName = &argv[i][9];
+            }
+            else if (strncmp (&argv[i][1], "-period=", 8) == 0) {
+                if (!parseCount (&argv[i][9], m_driver.periodSize))
+                    err = true;
+            }
+            else if (strncmp (&argv[i][1], "-periods=", 9) == 0) {
+                uint_least32_t periods;
+                if (!parseCount (&argv[i][10], periods))
+                    err = true;
+                m_driver.periods = periods;
+            }
+            else if (strncmp (&argv[i][1], "-buffer=", 8) == 0) {
+                if (!parseCount (&argv[i][9], m_driver.bufferTime))
+                    err = true;
+            }
+            else if (strncmp (&argv[i][1], "-rates=", 7) == 0) {
+                // Comma separated list of rates in Hz
+                const char *rate = &argv[i][8];
+                m_driver.rates.clear();
+                do {
+                    const unsigned int frequency = (unsigned int) atoi(rate);
+                    if (frequency == 0)
+                        err = true;
+                    m_driver.rates.push_back(frequency);
+                    rate = strchr(rate, ',');
+                } while (rate++);
+            }
+
+            // End of music detection
+            else if (strcmp (&argv[i][1], "-silence") == 0) {
+                m_silence.enabled = true;
+            }
+            else if (strncmp (&argv[i][1], "-silence=", 9) == 0) {
+                m_silence.enabled   = true;
+                m_silence.threshold = atof(&argv[i][10]);
+                if (m_silence.threshold >= 0.)
+                    err = true;
+            }
+            else if (strncmp (&argv[i][1], "-silence-hold=", 14) == 0) {
+                if (!parseTime (&argv[i][15], m_silence.hold) || (m_silence.hold == 0))
+                    err = true;
+            }
+
+            // Batch rendering
+            else if (strcmp (&argv[i][1], "-batch") == 0) {
+                m_batch.enabled = true;
+            }
+            else if (strncmp (&argv[i][1], "-threads=", 9) == 0) {
+                m_batch.threads = (unsigned int) atoi(&argv[i][10]);
+            }
+            else if (strncmp (&argv[i][1], "-outdir=", 8) == 0) {
+                if (argv[i][9] == '\0')
+                    err = true;
+                m_batch.outDir = &argv[i][9];
+            }
+            else if (strncmp (&argv[i][1], "-spool=", 7) == 0) {
+                if (argv[i][8] == '\0')
+                    err = true;
+                m_batch.spool = &argv[i][8];
+            }
+            else if (strcmp (&argv[i][1], "-find-lengths") == 0) {
+                findLengths = true;
+            }
+            else if (strncmp (&argv[i][1], "-find-lengths=", 14) == 0) {
+                if (argv[i][15] == '\0')
+                    err = true;
+                m_batch.lengthFile = &argv[i][15];
+            }
+            else if (strncmp (&argv[i][1], "-lease=", 7) == 0) {
+                m_batch.leaseTime = (uint_least32_t) atoi(&argv[i][8]);
+                if (m_batch.leaseTime == 0)
+                    err = true;
+            }
+            else if (strncmp (&argv[i][1], "-segments=", 10) == 0) {
+                m_batch.segments = (unsigned int) atoi(&argv[i][11]);
+            }
+            else if (strcmp (&argv[i][1], "-stems") == 0) {
+                m_batch.stems = true;
+            }
+            else if (strcmp (&argv[i][1], "-stems=mix") == 0) {
+                m_batch.stems    = true;
+                m_batch.stemsMix = true;
+            }
+            else if (strncmp (&argv[i][1], "-seek-warmup=", 13) == 0) {
+                if (!parseTime (&argv[i][14], m_timer.warmup))
+                    err = true;
+            }
+            else if (strncmp (&argv[i][1], "-preroll=", 9) == 0) {
+                if (!parseTime (&argv[i][10], m_batch.preroll))
+                    err = true;
+            }
 #ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
             else if (strcmp (&argv[i][1], "-residfp") == 0) {
                 m_driver.sid    = EMU_RESIDFP;
@@ -370,8 +545,7 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
         else { // Reading file name
             if (infile == 0)
                 infile = i;
-            else
-                err = true;
+            m_batch.inputs.push_back(argv[i]);
         }
 
         if (err) {
@@ -382,19 +556,75 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
         i++; // next index
     }
 
+    // Default to a songlength DB of our own
+    if (findLengths && m_batch.lengthFile.empty()) {
+#if !defined(_WIN32) || !defined(UNICODE)
+        try {
+            std::string dataPath(utils::getDataPath());
+            dataPath.append(SEPARATOR).append("sidplayfp");
+            if (makePath(dataPath))
+                m_batch.lengthFile = dataPath.append(SEPARATOR).append(LOCAL_SONGLENGTHS);
+        }
+        catch (utils::error const &e) {}
+#endif
+        if (m_batch.lengthFile.empty())
+            m_batch.lengthFile = LOCAL_SONGLENGTHS;
+    }
+
+    // Length scanning takes tunes like batch mode
+    if (lengthMode()) {
+#ifndef FEAT_REGS_DUMP_SID
+        displayError("ERROR: --find-lengths requires libsidplayfp 2.2 or later");
+        return -1;
+#endif
+        if (!m_batch.spool.empty() || (m_batch.segments > 1) || m_batch.stems) {
+            displayError("ERROR: --find-lengths cannot be used with spool, segmented or stem rendering");
+            return -1;
+        }
+        m_batch.enabled = true;
+    }
+
+    // Spool workers render files like batch mode
+    if (!m_batch.spool.empty())
+        m_batch.enabled = true;
+
+    // Only batch mode accepts more than one file
+    if (!m_batch.enabled && (m_batch.inputs.size() > 1)) {
+        displayArgs(m_batch.inputs[1].c_str());
+        return -1;
+    }
+
     const char* hvscBase = getenv("HVSC_BASE");
 
-    // Load the tune
-    m_filename = argv[infile];
-    m_tune.load(m_filename.c_str());
-    if (!m_tune.getStatus()) {
-        std::string errorString(m_tune.statusString());
+    if (m_batch.enabled) {
+        if (m_batch.inputs.empty() && m_batch.spool.empty()) {
+            displayArgs();
+            return -1;
+        }
 
-        // Try prepending HVSC_BASE
-        if (!hvscBase || !tryOpenTune(hvscBase)) {
-            displayError(errorString.c_str());
+        if (m_outfile != nullptr) {
+            displayError("ERROR: output file name cannot be used in batch mode, use --outdir");
             return -1;
         }
+
+        // Batch mode always renders to files
+        if (m_driver.output < OUT_WAV)
+            m_driver.output = OUT_WAV;
+        m_driver.file = true;
+    }
+    else {
+        // Load the tune
+        m_filename = argv[infile];
+        m_tune.load(m_filename.c_str());
+        if (!m_tune.getStatus()) {
+            std::string errorString(m_tune.statusString());
+
+            // Try prepending HVSC_BASE
+            if (!hvscBase || !tryOpenTune(hvscBase)) {
+                displayError(errorString.c_str());
+                return -1;
+            }
+        }
     }
 
     // If filename specified we can only convert one song
@@ -412,15 +642,85 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
         return -1;
     }
 
-    if (m_driver.info && m_driver.file) {
-        displayError("WARNING: metadata can be added only to wav files!");
+    if (m_driver.info && m_driver.file && ((m_driver.output == OUT_AU) || (m_driver.output == OUT_RAW))) {
+        displayError("WARNING: metadata can be added only to wav, flac and opus files!");
+    }
+
+    if (!m_batch.enabled && (m_batch.segments > 1)) {
+        if (!m_driver.file) {
+            displayError("ERROR: segmented rendering requires file output");
+            return -1;
+        }
+        if ((m_outfile != nullptr) && (strcmp(m_outfile, "-") == 0)) {
+            displayError("ERROR: segmented rendering cannot write to stdout");
+            return -1;
+        }
+        if (m_batch.preroll < 200) {
+            displayError("ERROR: pre-roll must be at least 0.2 seconds");
+            return -1;
+        }
+    }
+
+    if (!m_batch.enabled && m_batch.stems) {
+        if (!m_driver.file || (m_batch.segments > 1)) {
+            displayError("ERROR: stems require file output");
+            return -1;
+        }
+        if ((m_outfile != nullptr) && (strcmp(m_outfile, "-") == 0)) {
+            displayError("ERROR: stems cannot be written to stdout");
+            return -1;
+        }
+    }
+
+    if (m_driver.loudness && !(m_driver.file || m_batch.enabled)) {
+        displayError("ERROR: --loudness requires file output");
+        return -1;
+    }
+
+    if (!m_driver.rates.empty()) {
+        if (!(m_driver.file || m_batch.enabled) || m_batch.stems) {
+            displayError("ERROR: --rates requires file output");
+            return -1;
+        }
+        if ((m_outfile != nullptr) && (strcmp(m_outfile, "-") == 0)) {
+            displayError("ERROR: --rates cannot write to stdout");
+            return -1;
+        }
+        // The main output already has the engine rate
+        std::vector<unsigned int> rates;
+        for (std::vector<unsigned int>::const_iterator it = m_driver.rates.begin(); it != m_driver.rates.end(); ++it) {
+            if ((*it != m_engCfg.frequency) && (std::find(rates.begin(), rates.end(), *it) == rates.end()))
+                rates.push_back(*it);
+        }
+        m_driver.rates.swap(rates);
+    }
+
+    if (m_driver.multichannel && (m_batch.enabled || (m_batch.segments > 1) || m_batch.stems)) {
+        displayError("ERROR: --multichannel cannot be used with batch, segmented or stem rendering");
+        return -1;
+    }
+
+    if (m_silence.enabled && ((m_batch.segments > 1) || m_batch.stems)) {
+        displayError("ERROR: --silence cannot be used with segmented or stem rendering");
+        return -1;
+    }
+
+    if (m_driver.monitor) {
+        if (!m_driver.file || m_batch.enabled || (m_batch.segments > 1)) {
+            displayError("ERROR: --tee requires a single file output");
+            return -1;
+        }
+        // Playback sets the pace, the file is written along
+        m_driver.file = false;
     }
 
     // Select the desired track
-    m_track.first    = m_tune.selectSong (m_track.first);
-    m_track.selected = m_track.first;
-    if (m_track.single)
-        m_track.songs = 1;
+    if (!m_batch.enabled) {
+        m_track.first    = m_tune.selectSong (m_track.first);
+        m_track.selected = m_track.first;
+        if (m_track.single)
+            m_track.songs = 1;
+    }
 
     // If user provided no time then load songlength database
     // and set default lengths in case it's not found there.
@@ -459,7 +759,11 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
 #else
                     const char *database = (m_iniCfg.sidplayfp()).database.c_str();
 #endif
+#if defined(_WIN32) && defined(UNICODE) && defined(FEAT_DB_WCHAR_OPEN)
                     if (!m_database.open(database)) {
+#else
+                    if (!openDatabase(database)) {
+#endif
                         displayError (m_database.error ());
                         return -1;
                     }
@@ -471,6 +775,18 @@ int ConsolePlayer::args(int argc, const char *argv[]) {
         }
     }
 
+#if !defined(_WIN32) || !defined(UNICODE)
+    // Load the MD5 cache, saves hashing tunes again
+    // for songlength lookups
+    try {
+        std::string cachePath(utils::getDataPath());
+        cachePath.append(SEPARATOR).append("sidplayfp");
+        if (makePath(cachePath))
+            m_md5Cache.open(cachePath.append(SEPARATOR).append("md5cache"));
+    }
+    catch (utils::error const &e) {}
+#endif
+
 #if HAVE_TSID == 1
     // Set TSIDs base directory
     if (!m_tsid.setBaseDir(true)) {
@@ -494,12 +810,14 @@ void ConsolePlayer::displayArgs (const char *arg) {
     if (arg)
         out << "Syntax error: " << arg << endl;
     else
-        out << "Syntax: " << m_name << " [options] <file>" << endl;
+        out << "Syntax: " << m_name << " [options] <file>" << endl
+            << "        " << m_name << " --batch [options] <file|dir|@list>..." << endl;
 
     out << "Options:" << endl
         << " --help|-h   Display this screen" << endl
         << " --help-dbg  Debug help menu" << endl
         << " -b<num>     Set start time in [min:]sec[.milli] format" << endl
+        << " --seek-warmup=<time> Emulate the filter again this long before the start time (default: 1)" << endl
         << " -f<num>     Set frequency in Hz, default: " << SidConfig::DEFAULT_SAMPLING_FREQ << endl
         << " -ds<addr>   Set SID #2 address (e.g. -ds0xd420)" << endl
 #ifdef FEAT_THIRD_SID
@@ -508,9 +826,10 @@ void ConsolePlayer::displayArgs (const char *arg) {
         << " -nf         No SID filter emulation" << endl
         << " -o<l|s>     Looping and/or single track" << endl
         << " -o<num>     Start track (default: preset)" << endl
-        << " -p<16|32>   Set format for file output (16 = signed 16 bit, 32 = 32 bit float, default: 16)" << endl
+        << " -p<16|24|32> Set format for file output (16/24 = signed 16/24 bit, 32 = 32 bit float, default: 16)" << endl
         << " -s          Force stereo output" << endl
         << " -m          Force mono output" << endl
+        << " --multichannel Output each SID chip on its own channel" << endl
         << " -m<num>     Mute voice <num> (e.g. -m1 -m2)" << endl
         << " -m<o|n>[f]  Set SID new/old chip model (default: old)," << endl
         << "             use 'f' to force the model" << endl
@@ -525,7 +844,36 @@ void ConsolePlayer::displayArgs (const char *arg) {
         << "             use 'f' to enable fast resampling (only for reSID)" << endl
         << " -w[name]    Create wav file (default: <datafile>[n].wav)" << endl
         << " --au[name]  Create au file (default: <datafile>[n].au)" << endl
-        << " --info      Add metadata to wav file" << endl;
+        << " --raw[name] Create headerless pcm file, use - for stdout (default: <datafile>[n].raw)" << endl
+#ifdef HAVE_FLAC
+        << " --flac[name] Create flac file (default: <datafile>[n].flac)" << endl
+#endif
+#ifdef HAVE_OPUSENC
+        << " --opus[name] Create ogg/opus file (default: <datafile>[n].opus)" << endl
+#endif
+        << " --info      Add metadata to wav, flac and opus files" << endl
+        << " --loudness  Measure the EBU R128 loudness and true peak of the files" << endl
+        << " --tee       Play on the soundcard while writing the file" << endl
+        << " --rates=<list> Also write the file resampled to each rate, e.g. 44100,96000" << endl
+        << " --silence[=<dB>] End songs of unknown length when the music fades out" << endl
+        << "             below the level (default: -60)" << endl
+        << " --silence-hold=<time> Time the level must stay below it (default: 5)" << endl
+        << " --batch     Render all the given tunes, directories and lists to files" << endl
+        << " --threads=<num> Number of batch render threads (default: one per core)" << endl
+        << " --outdir=<dir>  Batch output directory, mirrors input directories (default: .)" << endl
+        << " --segments=<num> Split each song of a file render in <num> parallel segments" << endl
+        << " --preroll=<time> Warm-up before each segment (default: 1)" << endl
+        << " --stems[=mix]   Render each voice to its own file, in parallel," << endl
+        << "                 with =mix the full mix too, checked against the stems" << endl
+        << " --spool=<dir>   Queue the given tunes in a shared spool directory," << endl
+        << "                 or render queued jobs if none is given" << endl
+        << " --find-lengths[=<file>] Find the length of the songs missing from the songlength DB" << endl
+        << "                 by looking for loops, into <file> (default: Songlengths.md5 in the data directory)" << endl
+        << " --lease=<secs>  Time before jobs of an unresponsive worker are requeued (default: 60)" << endl
+        << " --device=<name> Soundcard device (default: system default)" << endl
+        << " --period=<num>  Soundcard period size in frames" << endl
+        << " --periods=<num> Number of periods in the soundcard buffer" << endl
+        << " --buffer=<ms>   Soundcard buffer length in milliseconds" << endl;
 
 #ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
     out << " --residfp   use reSIDfp emulation (default)" << endl;
@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include <string>
+
 class AudioConfig
 {
 public:
@@ -30,12 +32,30 @@ public:
     int            precision;
     int            channels;
     uint_least32_t bufSize;       // sample buffer size
+    uint_least32_t length;        // expected length in ms for file output, 0 if unknown
+
+    // Device settings, empty or 0 for the driver default.
+    // Drivers that support them update them on open
+    // with the negotiated values.
+    std::string    device;
+    uint_least32_t periodSize;    // frames
+    unsigned int   periods;
+    uint_least32_t bufferTime;    // us
+
+    uint_least32_t latency;       // measured output delay in frames, 0 if unknown
+    uint_least32_t underruns;     // times the device ran out of data
 
     AudioConfig() :
         frequency(48000),
         precision(16),
         channels(1),
-        bufSize(0) {}
+        bufSize(0),
+        length(0),
+        periodSize(0),
+        periods(0),
+        bufferTime(0),
+        latency(0),
+        underruns(0) {}
 
     uint_least32_t bytesPerMillis() const { return (precision/8 * channels * frequency) / 1000; }
 };
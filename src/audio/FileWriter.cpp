@@ -0,0 +1,482 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "FileWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+
+#ifdef HAVE_VMSPLICE
+#  include <poll.h>
+#  include <sys/ioctl.h>
+#  include <sys/uio.h>
+#endif
+
+#ifndef O_BINARY
+#  define O_BINARY 0
+#endif
+
+// Blocks start on a page boundary
+const size_t ALIGNMENT = 4096;
+
+FileWriter::FileWriter(size_t blockSize) :
+    m_base(nullptr),
+    m_blockSize(blockSize),
+    m_current(0),
+    m_fill(0),
+    m_offset(0),
+#ifdef HAVE_UNISTD_H
+    m_fd(-1),
+#else
+    m_file(nullptr),
+#endif
+    m_open(false),
+    m_seekable(false),
+#ifdef HAVE_VMSPLICE
+    m_splice(false),
+    m_spliced(-1),
+#endif
+#ifdef HAVE_LIBURING
+    m_uring(false),
+#endif
+    m_quit(false),
+    m_failed(false)
+{
+    for (unsigned int i = 0; i < BLOCKS; i++)
+        m_busy[i] = false;
+}
+
+// Keep the first error only
+void FileWriter::setError(const char *msg)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_failed)
+    {
+        m_error = msg;
+        m_failed = true;
+    }
+}
+
+bool FileWriter::open(const std::string &name)
+{
+    close();
+
+    m_memory.assign(BLOCKS * m_blockSize + ALIGNMENT, 0);
+    m_base = &m_memory[0] + ((ALIGNMENT - ((uintptr_t)&m_memory[0] % ALIGNMENT)) % ALIGNMENT);
+    m_current = 0;
+    m_fill    = 0;
+    m_offset  = 0;
+    m_quit    = false;
+    m_failed  = false;
+    m_error.clear();
+
+#ifdef HAVE_UNISTD_H
+    if (name.compare("-") == 0)
+    {
+        m_fd = STDOUT_FILENO;
+    }
+    else
+    {
+        m_fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+        if (m_fd < 0)
+        {
+            setError(strerror(errno));
+            return false;
+        }
+    }
+
+    struct stat st;
+    const bool stated = fstat(m_fd, &st) == 0;
+    m_seekable = stated && S_ISREG(st.st_mode);
+
+#ifdef HAVE_VMSPLICE
+    // A block is known to be read once the whole next one
+    // went into the pipe only if it can't fit in the pipe
+    const int pipeSize = (stated && S_ISFIFO(st.st_mode)) ? fcntl(m_fd, F_GETPIPE_SZ) : -1;
+    m_splice  = (pipeSize > 0) && ((size_t) pipeSize < m_blockSize);
+    m_spliced = -1;
+#endif
+#else
+    if (name.compare("-") == 0)
+    {
+        m_file = stdout;
+        m_seekable = false;
+    }
+    else
+    {
+        m_file = std::fopen(name.c_str(), "wb");
+        if (m_file == nullptr)
+        {
+            setError(strerror(errno));
+            return false;
+        }
+        m_seekable = true;
+    }
+#endif
+    m_open = true;
+
+#ifdef HAVE_LIBURING
+    // Positioned writes only, pipes keep the writer thread
+    if (m_seekable && (io_uring_queue_init(BLOCKS, &m_ring, 0) == 0))
+    {
+        struct iovec iov[BLOCKS];
+        for (unsigned int i = 0; i < BLOCKS; i++)
+        {
+            iov[i].iov_base = blockData(i);
+            iov[i].iov_len  = m_blockSize;
+        }
+        m_uring = io_uring_register_buffers(&m_ring, iov, BLOCKS) == 0;
+        if (!m_uring)
+            io_uring_queue_exit(&m_ring);
+    }
+    if (m_uring)
+        return true;
+#endif
+
+    m_thread = std::thread(&FileWriter::writer, this);
+    return true;
+}
+
+void FileWriter::preallocate(uint_least64_t bytes)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    // Just a hint, the file size is not changed
+    if (m_open && m_seekable && bytes)
+        fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, bytes);
+#else
+    (void) bytes;
+#endif
+}
+
+#ifdef HAVE_VMSPLICE
+// Map the pages into the pipe instead of copying them.
+// They must not be touched until the reader got them.
+bool FileWriter::spliceOut(const uint8_t *data, size_t size)
+{
+    while (size)
+    {
+        struct iovec iov;
+        iov.iov_base = const_cast<uint8_t*>(data);
+        iov.iov_len  = size;
+        const ssize_t n = vmsplice(m_fd, &iov, 1, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            setError(strerror(errno));
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Wait for the reader to empty the pipe so that
+// the last block can be reused
+void FileWriter::drainPipe()
+{
+    for (;;)
+    {
+        struct pollfd pfd;
+        pfd.fd      = m_fd;
+        pfd.events  = POLLOUT;
+        pfd.revents = 0;
+        int pending = 0;
+        if ((poll(&pfd, 1, 0) < 0) || (pfd.revents & POLLERR)
+            || (ioctl(m_fd, FIONREAD, &pending) != 0) || (pending <= 0))
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_spliced >= 0)
+        m_busy[m_spliced] = false;
+    m_spliced = -1;
+}
+#endif
+
+bool FileWriter::writeAt(const uint8_t *data, size_t size, uint_least64_t offset)
+{
+#ifdef HAVE_UNISTD_H
+#  ifdef HAVE_VMSPLICE
+    if (m_splice)
+        return spliceOut(data, size);
+#  endif
+    while (size)
+    {
+        const ssize_t n = m_seekable
+            ? ::pwrite(m_fd, data, size, (off_t) offset)
+            : ::write(m_fd, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            setError(strerror(errno));
+            return false;
+        }
+        data   += n;
+        size   -= n;
+        offset += n;
+    }
+    return true;
+#else
+    if ((m_seekable && std::fseek(m_file, (long) offset, SEEK_SET) != 0)
+        || (std::fwrite(data, 1, size, m_file) != size))
+    {
+        setError(strerror(errno));
+        return false;
+    }
+    return true;
+#endif
+}
+
+void FileWriter::writer()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    for (;;)
+    {
+        m_wakeup.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+        if (m_queue.empty())
+            break;
+
+        const request_t req = m_queue.front();
+        m_queue.pop_front();
+
+        lock.unlock();
+        writeAt(blockData(req.block), req.size, req.offset);
+        lock.lock();
+
+#ifdef HAVE_VMSPLICE
+        if (m_splice)
+        {
+            // This block may still be in the pipe, the previous
+            // one has been read since a whole block followed it
+            if (m_spliced >= 0)
+                m_busy[m_spliced] = false;
+            m_spliced = req.block;
+        }
+        else
+#endif
+        m_busy[req.block] = false;
+        m_wakeup.notify_all();
+    }
+}
+
+// Hand the current block over and move on to the next one
+void FileWriter::submit()
+{
+    if (!m_fill)
+        return;
+
+    request_t req;
+    req.block  = m_current;
+    req.size   = m_fill;
+    req.offset = m_offset;
+
+    m_pending[m_current] = req;
+
+#ifdef HAVE_LIBURING
+    if (m_uring)
+    {
+        m_busy[req.block] = true;
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+        io_uring_prep_write_fixed(sqe, m_fd, blockData(req.block),
+                                  req.size, req.offset, req.block);
+        io_uring_sqe_set_data(sqe, &m_pending[req.block]);
+        const int err = io_uring_submit(&m_ring);
+        if (err < 0)
+        {
+            // Do it ourselves
+            m_busy[req.block] = false;
+            writeAt(blockData(req.block), req.size, req.offset);
+        }
+    }
+    else
+#endif
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_busy[req.block] = true;
+        m_queue.push_back(req);
+        m_wakeup.notify_all();
+    }
+
+    m_offset += m_fill;
+    m_fill = 0;
+    m_current = (m_current + 1) % BLOCKS;
+}
+
+bool FileWriter::waitBlock(unsigned int block)
+{
+#ifdef HAVE_LIBURING
+    if (m_uring)
+    {
+        while (m_busy[block])
+        {
+            struct io_uring_cqe *cqe;
+            const int err = io_uring_wait_cqe(&m_ring, &cqe);
+            if (err < 0)
+            {
+                if (err == -EINTR)
+                    continue;
+                setError(strerror(-err));
+                return false;
+            }
+
+            const request_t *req = static_cast<const request_t*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(&m_ring, cqe);
+
+            m_busy[req->block] = false;
+            if (res < 0)
+                setError(strerror(-res));
+            else if ((size_t) res < req->size)
+                writeAt(blockData(req->block) + res, req->size - res, req->offset + res);
+        }
+        return !m_failed;
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_wakeup.wait(lock, [this, block] { return !m_busy[block]; });
+    return !m_failed;
+}
+
+bool FileWriter::write(const void *data, size_t size)
+{
+    if (!m_open || m_failed)
+        return false;
+
+    const uint8_t *src = static_cast<const uint8_t*>(data);
+    while (size)
+    {
+        const size_t n = std::min(size, m_blockSize - m_fill);
+        std::memcpy(blockData(m_current) + m_fill, src, n);
+        m_fill += n;
+        src    += n;
+        size   -= n;
+
+        if (m_fill == m_blockSize)
+        {
+            submit();
+            if (!waitBlock(m_current))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool FileWriter::flush()
+{
+    if (!m_open)
+        return false;
+
+    submit();
+
+#ifdef HAVE_VMSPLICE
+    if (m_splice)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wakeup.wait(lock, [this] {
+                for (unsigned int i = 0; i < BLOCKS; i++)
+                {
+                    if (m_busy[i] && ((int) i != m_spliced))
+                        return false;
+                }
+                return true;
+            });
+        }
+        drainPipe();
+        return !m_failed;
+    }
+#endif
+
+    for (unsigned int i = 0; i < BLOCKS; i++)
+        waitBlock(i);
+    return !m_failed;
+}
+
+bool FileWriter::pwrite(const void *data, size_t size, uint_least64_t offset)
+{
+    if (!m_open || !m_seekable)
+        return false;
+
+    return writeAt(static_cast<const uint8_t*>(data), size, offset);
+}
+
+bool FileWriter::close()
+{
+    if (!m_open)
+        return !m_failed;
+
+    flush();
+
+#ifdef HAVE_LIBURING
+    if (m_uring)
+    {
+        io_uring_queue_exit(&m_ring);
+        m_uring = false;
+    }
+#endif
+
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_quit = true;
+        }
+        m_wakeup.notify_all();
+        m_thread.join();
+    }
+
+#ifdef HAVE_UNISTD_H
+    if (m_fd != STDOUT_FILENO)
+    {
+        if (::close(m_fd) != 0)
+            setError(strerror(errno));
+    }
+    m_fd = -1;
+#else
+    if (m_file != stdout)
+    {
+        if (std::fclose(m_file) != 0)
+            setError(strerror(errno));
+    }
+    else
+    {
+        std::fflush(m_file);
+    }
+    m_file = nullptr;
+#endif
+
+    m_open = false;
+    m_memory.clear();
+    m_base = nullptr;
+    return !m_failed;
+}
@@ -0,0 +1,148 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdio>
+#include <stdint.h>
+
+#ifdef HAVE_LIBURING
+#  include <liburing.h>
+#endif
+
+/*
+ * Double buffered output file.
+ *
+ * Data is appended to a block in memory; full blocks are
+ * written in the background while the next one is filled,
+ * so the caller only waits when the disk can't keep up.
+ * Blocks go to io_uring as fixed buffers when available,
+ * otherwise a writer thread does the writes.
+ * When the output is a pipe the pages of each block are
+ * handed over with vmsplice instead of being copied.
+ */
+class FileWriter
+{
+private:
+    static const unsigned int BLOCKS = 2;
+
+    struct request_t
+    {
+        unsigned int   block;
+        size_t         size;
+        uint_least64_t offset;
+    };
+
+private:
+    std::vector<uint8_t> m_memory;
+    uint8_t *m_base;         // page aligned start of the blocks
+    size_t m_blockSize;
+
+    unsigned int m_current;  // block being filled
+    size_t m_fill;           // bytes in current block
+    uint_least64_t m_offset; // file offset of current block
+
+    bool m_busy[BLOCKS];     // block being written
+    request_t m_pending[BLOCKS];
+
+#ifdef HAVE_UNISTD_H
+    int m_fd;
+#else
+    std::FILE *m_file;
+#endif
+    bool m_open;
+    bool m_seekable;
+
+#ifdef HAVE_VMSPLICE
+    bool m_splice;
+    int m_spliced;           // block whose pages may still be in the pipe
+#endif
+
+#ifdef HAVE_LIBURING
+    struct io_uring m_ring;
+    bool m_uring;
+#endif
+
+    // Writer thread
+    std::thread m_thread;
+    std::mutex m_lock;
+    std::condition_variable m_wakeup;
+    std::deque<request_t> m_queue;
+    bool m_quit;
+
+    std::atomic<bool> m_failed;
+    std::string m_error;
+
+private:
+    uint8_t *blockData(unsigned int n) const { return m_base + n * m_blockSize; }
+
+    bool writeAt(const uint8_t *data, size_t size, uint_least64_t offset);
+#ifdef HAVE_VMSPLICE
+    bool spliceOut(const uint8_t *data, size_t size);
+    void drainPipe();
+#endif
+    void setError(const char *msg);
+
+    void submit();
+    bool waitBlock(unsigned int block);
+    void writer();
+
+public:
+    FileWriter(size_t blockSize = 1 << 20);
+    ~FileWriter() { close(); }
+
+    // "-" is standard output
+    bool open(const std::string &name);
+
+    // Reserve disk space for the expected file size, if supported
+    void preallocate(uint_least64_t bytes);
+
+    // Append data
+    bool write(const void *data, size_t size);
+
+    // Wait until everything appended so far is on disk
+    bool flush();
+
+    // Write at a given position, e.g. to patch a header.
+    // Only for seekable files, call flush() first.
+    bool pwrite(const void *data, size_t size, uint_least64_t offset);
+
+    // Flush and close, returns false if any write failed
+    bool close();
+
+    bool isOpen() const { return m_open; }
+    bool seekable() const { return m_seekable; }
+    bool failed() const { return m_failed; }
+    const char *error() const { return m_error.c_str(); }
+};
+
+#endif // FILEWRITER_H
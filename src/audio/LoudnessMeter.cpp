@@ -0,0 +1,519 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "LoudnessMeter.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#  define LOUDNESS_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define LOUDNESS_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace
+{
+
+const double PI = 3.14159265358979323846;
+
+const double SCALE = 1. / 32768.;
+
+// Steps per second and block lengths in steps
+const unsigned int STEP_RATE = 10;
+const unsigned int MOMENTARY_STEPS = 4;
+const unsigned int SHORT_TERM_STEPS = 30;
+
+const double ABSOLUTE_GATE = -70.;
+const double RELATIVE_GATE = -10.;
+const double RANGE_GATE = -20.;
+
+// Taps of each true peak filter phase
+const unsigned int PEAK_TAPS = 12;
+
+const unsigned int LANES = 4;
+
+inline double loudness(double meanSquare)
+{
+    return (meanSquare > 0.) ? -0.691 + 10. * std::log10(meanSquare) : -HUGE_VAL;
+}
+
+inline double meanSquare(double lufs)
+{
+    return std::pow(10., (lufs + 0.691) / 10.);
+}
+
+// K-weighting of one channel, returns the sum of the squares.
+// Coefficients are b0 b1 b2 a1 a2 of both stages, the state
+// holds the two delays of both stages.
+double kfilterScalar(const short *in, size_t frames, unsigned int stride, const double (*k)[5], double *s)
+{
+    double s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+    double sum = 0.;
+    for (size_t i = 0; i < frames; i++)
+    {
+        const double x = in[i * stride] * SCALE;
+        const double y = k[0][0] * x + s0;
+        s0 = k[0][1] * x - k[0][3] * y + s1;
+        s1 = k[0][2] * x - k[0][4] * y;
+        const double z = k[1][0] * y + s2;
+        s2 = k[1][1] * y - k[1][3] * z + s3;
+        s3 = k[1][2] * y - k[1][4] * z;
+        sum += z * z;
+    }
+    s[0] = s0; s[1] = s1; s[2] = s2; s[3] = s3;
+    return sum;
+}
+
+// Oversampled peak of one channel, lanes are filter phases
+#if !defined(LOUDNESS_SSE2) && !defined(LOUDNESS_NEON)
+float peakScalar(const float *history, size_t outputs, const float *coeffs, float peak)
+{
+    for (size_t n = 0; n < outputs; n++)
+    {
+        float acc[LANES] = { 0.f, 0.f, 0.f, 0.f };
+        for (unsigned int k = 0; k < PEAK_TAPS; k++)
+        {
+            for (unsigned int p = 0; p < LANES; p++)
+                acc[p] += coeffs[k * LANES + p] * history[n + k];
+        }
+        for (unsigned int p = 0; p < LANES; p++)
+            peak = std::max(peak, std::fabs(acc[p]));
+    }
+    return peak;
+}
+#endif
+
+// The SIMD K-weighting filters take a pair of channels, one per lane
+
+#ifdef LOUDNESS_SSE2
+
+double kfilterSSE2(const short *in, size_t frames, unsigned int stride, const double (*k)[5], double *s)
+{
+    const __m128d scale = _mm_set1_pd(SCALE);
+    __m128d c[2][5];
+    for (int j = 0; j < 2; j++)
+        for (int i = 0; i < 5; i++)
+            c[j][i] = _mm_set1_pd(k[j][i]);
+
+    __m128d s0 = _mm_set_pd(s[4], s[0]);
+    __m128d s1 = _mm_set_pd(s[5], s[1]);
+    __m128d s2 = _mm_set_pd(s[6], s[2]);
+    __m128d s3 = _mm_set_pd(s[7], s[3]);
+    __m128d sum = _mm_setzero_pd();
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const short *frame = in + i * stride;
+        const __m128d x = _mm_mul_pd(_mm_set_pd(frame[1], frame[0]), scale);
+        const __m128d y = _mm_add_pd(_mm_mul_pd(c[0][0], x), s0);
+        s0 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(c[0][1], x), _mm_mul_pd(c[0][3], y)), s1);
+        s1 = _mm_sub_pd(_mm_mul_pd(c[0][2], x), _mm_mul_pd(c[0][4], y));
+        const __m128d z = _mm_add_pd(_mm_mul_pd(c[1][0], y), s2);
+        s2 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(c[1][1], y), _mm_mul_pd(c[1][3], z)), s3);
+        s3 = _mm_sub_pd(_mm_mul_pd(c[1][2], y), _mm_mul_pd(c[1][4], z));
+        sum = _mm_add_pd(sum, _mm_mul_pd(z, z));
+    }
+
+    _mm_storel_pd(s + 0, s0); _mm_storeh_pd(s + 4, s0);
+    _mm_storel_pd(s + 1, s1); _mm_storeh_pd(s + 5, s1);
+    _mm_storel_pd(s + 2, s2); _mm_storeh_pd(s + 6, s2);
+    _mm_storel_pd(s + 3, s3); _mm_storeh_pd(s + 7, s3);
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+float peakSSE2(const float *history, size_t outputs, const float *coeffs, float peak)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    __m128 c[PEAK_TAPS];
+    for (unsigned int k = 0; k < PEAK_TAPS; k++)
+        c[k] = _mm_loadu_ps(coeffs + k * LANES);
+
+    __m128 max = _mm_set1_ps(peak);
+    for (size_t n = 0; n < outputs; n++)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (unsigned int k = 0; k < PEAK_TAPS; k++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(c[k], _mm_set1_ps(history[n + k])));
+        max = _mm_max_ps(max, _mm_andnot_ps(sign, acc));
+    }
+    max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+    max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+    return _mm_cvtss_f32(max);
+}
+
+#endif // LOUDNESS_SSE2
+
+#ifdef LOUDNESS_NEON
+
+#if defined(__aarch64__)
+double kfilterNEON(const short *in, size_t frames, unsigned int stride, const double (*k)[5], double *s)
+{
+    const float64x2_t scale = vdupq_n_f64(SCALE);
+    float64x2_t c[2][5];
+    for (int j = 0; j < 2; j++)
+        for (int i = 0; i < 5; i++)
+            c[j][i] = vdupq_n_f64(k[j][i]);
+
+    const double init[4][2] = { { s[0], s[4] }, { s[1], s[5] }, { s[2], s[6] }, { s[3], s[7] } };
+    float64x2_t s0 = vld1q_f64(init[0]);
+    float64x2_t s1 = vld1q_f64(init[1]);
+    float64x2_t s2 = vld1q_f64(init[2]);
+    float64x2_t s3 = vld1q_f64(init[3]);
+    float64x2_t sum = vdupq_n_f64(0.);
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        const short *frame = in + i * stride;
+        const double pair[2] = { (double)frame[0], (double)frame[1] };
+        const float64x2_t x = vmulq_f64(vld1q_f64(pair), scale);
+        const float64x2_t y = vfmaq_f64(s0, c[0][0], x);
+        s0 = vaddq_f64(vfmsq_f64(vmulq_f64(c[0][1], x), c[0][3], y), s1);
+        s1 = vfmsq_f64(vmulq_f64(c[0][2], x), c[0][4], y);
+        const float64x2_t z = vfmaq_f64(s2, c[1][0], y);
+        s2 = vaddq_f64(vfmsq_f64(vmulq_f64(c[1][1], y), c[1][3], z), s3);
+        s3 = vfmsq_f64(vmulq_f64(c[1][2], y), c[1][4], z);
+        sum = vfmaq_f64(sum, z, z);
+    }
+
+    s[0] = vgetq_lane_f64(s0, 0); s[4] = vgetq_lane_f64(s0, 1);
+    s[1] = vgetq_lane_f64(s1, 0); s[5] = vgetq_lane_f64(s1, 1);
+    s[2] = vgetq_lane_f64(s2, 0); s[6] = vgetq_lane_f64(s2, 1);
+    s[3] = vgetq_lane_f64(s3, 0); s[7] = vgetq_lane_f64(s3, 1);
+    return vgetq_lane_f64(sum, 0) + vgetq_lane_f64(sum, 1);
+}
+#endif
+
+float peakNEON(const float *history, size_t outputs, const float *coeffs, float peak)
+{
+    float32x4_t c[PEAK_TAPS];
+    for (unsigned int k = 0; k < PEAK_TAPS; k++)
+        c[k] = vld1q_f32(coeffs + k * LANES);
+
+    float32x4_t max = vdupq_n_f32(peak);
+    for (size_t n = 0; n < outputs; n++)
+    {
+        float32x4_t acc = vdupq_n_f32(0.f);
+        for (unsigned int k = 0; k < PEAK_TAPS; k++)
+            acc = vmlaq_n_f32(acc, c[k], history[n + k]);
+        max = vmaxq_f32(max, vabsq_f32(acc));
+    }
+    float32x2_t m = vpmax_f32(vget_low_f32(max), vget_high_f32(max));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+}
+
+#endif // LOUDNESS_NEON
+
+#if defined(LOUDNESS_SSE2)
+#  define KFILTER_PAIR kfilterSSE2
+#  define PEAK_KERNEL  peakSSE2
+#elif defined(LOUDNESS_NEON)
+#  if defined(__aarch64__)
+#    define KFILTER_PAIR kfilterNEON
+#  endif
+#  define PEAK_KERNEL  peakNEON
+#else
+#  define PEAK_KERNEL  peakScalar
+#endif
+
+// Zeroth order modified Bessel function, for the Kaiser window
+double besselI0(double x)
+{
+    double sum = 1.;
+    double term = 1.;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2. * k)) * (x / (2. * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+double toDb(double value)
+{
+    return (value > 0.) ? 20. * std::log10(value) : -HUGE_VAL;
+}
+
+// Nearest rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p)
+{
+    const size_t n = sorted.size();
+    size_t i = (size_t)std::ceil(p * n);
+    i = (i > 0) ? i - 1 : 0;
+    return sorted[std::min(i, n - 1)];
+}
+
+}
+
+LoudnessMeter::LoudnessMeter() :
+    m_channels(0),
+    m_rate(0),
+    m_oversample(1),
+    m_stepFrames(0),
+    m_stepFill(0),
+    m_stepEnergy(0.),
+    m_stepCount(0),
+    m_truePeak(0.f),
+    m_samplePeak(0),
+    m_clipped(0),
+    m_frames(0)
+{
+    finish();
+}
+
+const char *LoudnessMeter::simd()
+{
+#if defined(LOUDNESS_SSE2)
+    return "SSE2";
+#elif defined(LOUDNESS_NEON)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
+bool LoudnessMeter::setup(unsigned int rate, unsigned int channels)
+{
+    if (!rate || !channels || (channels > 4))
+        return false;
+
+    m_channels = channels;
+    m_rate     = rate;
+
+    // ITU-R BS.1770 K-weighting, derived for the actual rate
+    {
+        const double f0 = 1681.974450955533;
+        const double G  = 3.999843853973347;
+        const double Q  = 0.7071752369554196;
+        const double K  = std::tan(PI * f0 / rate);
+        const double Vh = std::pow(10., G / 20.);
+        const double Vb = std::pow(Vh, 0.4996667741545416);
+        const double a0 = 1. + K / Q + K * K;
+        m_coeffs[0][0] = (Vh + Vb * K / Q + K * K) / a0;
+        m_coeffs[0][1] = 2. * (K * K - Vh) / a0;
+        m_coeffs[0][2] = (Vh - Vb * K / Q + K * K) / a0;
+        m_coeffs[0][3] = 2. * (K * K - 1.) / a0;
+        m_coeffs[0][4] = (1. - K / Q + K * K) / a0;
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double Q  = 0.5003270373238773;
+        const double K  = std::tan(PI * f0 / rate);
+        const double a0 = 1. + K / Q + K * K;
+        m_coeffs[1][0] = 1.;
+        m_coeffs[1][1] = -2.;
+        m_coeffs[1][2] = 1.;
+        m_coeffs[1][3] = 2. * (K * K - 1.) / a0;
+        m_coeffs[1][4] = (1. - K / Q + K * K) / a0;
+    }
+
+    // True peak needs at least 192 kHz
+    m_oversample = (rate < 96000) ? 4 : (rate < 192000) ? 2 : 1;
+    m_peakCoeffs.assign(PEAK_TAPS * LANES, 0.f);
+    for (unsigned int p = 0; p < m_oversample; p++)
+    {
+        double sum = 0.;
+        double h[PEAK_TAPS];
+        for (unsigned int k = 0; k < PEAK_TAPS; k++)
+        {
+            const double x = (double)k - (PEAK_TAPS / 2 - 1) - (double)p / m_oversample;
+            const double t = x / (PEAK_TAPS / 2);
+            const double w = (t * t < 1.) ? besselI0(6. * std::sqrt(1. - t * t)) / besselI0(6.) : 0.;
+            h[k] = ((x == 0.) ? 1. : std::sin(PI * x) / (PI * x)) * w;
+            sum += h[k];
+        }
+        for (unsigned int k = 0; k < PEAK_TAPS; k++)
+            m_peakCoeffs[k * LANES + p] = (float)(h[k] / sum);
+    }
+
+    m_stepFrames = (rate + STEP_RATE / 2) / STEP_RATE;
+    m_stepFill   = 0;
+    m_stepEnergy = 0.;
+    m_stepCount  = 0;
+    m_state.assign(channels * 4, 0.);
+    m_steps.assign(SHORT_TERM_STEPS, 0.);
+    m_momentary.clear();
+    m_shortTerm.clear();
+    m_history.assign(channels, std::vector<float>(PEAK_TAPS - 1, 0.f));
+    m_truePeak   = 0.f;
+    m_samplePeak = 0;
+    m_clipped    = 0;
+    m_frames     = 0;
+
+    finish();
+    return true;
+}
+
+// A 100 ms step is complete
+void LoudnessMeter::step()
+{
+    m_steps[m_stepCount % SHORT_TERM_STEPS] = m_stepEnergy / m_stepFrames;
+    m_stepCount++;
+    m_stepEnergy = 0.;
+    m_stepFill   = 0;
+
+    if (m_stepCount >= MOMENTARY_STEPS)
+    {
+        double sum = 0.;
+        for (unsigned int i = 1; i <= MOMENTARY_STEPS; i++)
+            sum += m_steps[(m_stepCount - i) % SHORT_TERM_STEPS];
+        m_momentary.push_back(sum / MOMENTARY_STEPS);
+    }
+    if (m_stepCount >= SHORT_TERM_STEPS)
+    {
+        double sum = 0.;
+        for (unsigned int i = 0; i < SHORT_TERM_STEPS; i++)
+            sum += m_steps[i];
+        m_shortTerm.push_back(sum / SHORT_TERM_STEPS);
+    }
+}
+
+void LoudnessMeter::process(const short *in, size_t frames)
+{
+    if (!m_channels)
+        return;
+
+    const size_t samples = frames * m_channels;
+    for (size_t i = 0; i < samples; i++)
+    {
+        const int s = in[i];
+        if ((s >= 32767) || (s <= -32768))
+            m_clipped++;
+        m_samplePeak = std::max(m_samplePeak, std::abs(s));
+    }
+    m_frames += frames;
+
+    // K-weighted energy, a step at a time
+    for (size_t done = 0; done < frames; )
+    {
+        const size_t n = std::min<size_t>(frames - done, m_stepFrames - m_stepFill);
+        const short *chunk = in + done * m_channels;
+
+        unsigned int c = 0;
+#ifdef KFILTER_PAIR
+        for (; c + 2 <= m_channels; c += 2)
+            m_stepEnergy += KFILTER_PAIR(chunk + c, n, m_channels, m_coeffs, &m_state[c * 4]);
+#endif
+        for (; c < m_channels; c++)
+            m_stepEnergy += kfilterScalar(chunk + c, n, m_channels, m_coeffs, &m_state[c * 4]);
+
+        done += n;
+        m_stepFill += n;
+        if (m_stepFill == m_stepFrames)
+            step();
+    }
+
+    // True peak
+    if (m_oversample > 1)
+    {
+        for (unsigned int c = 0; c < m_channels; c++)
+        {
+            std::vector<float> &history = m_history[c];
+            for (size_t i = 0; i < frames; i++)
+                history.push_back(in[i * m_channels + c] * (float)SCALE);
+            m_truePeak = PEAK_KERNEL(&history[0], frames, &m_peakCoeffs[0], m_truePeak);
+            history.erase(history.begin(), history.end() - (PEAK_TAPS - 1));
+        }
+    }
+}
+
+void LoudnessMeter::finish()
+{
+    m_result.frames     = m_frames;
+    m_result.clipped    = m_clipped;
+    m_result.samplePeak = toDb(m_samplePeak / 32768.);
+    m_result.truePeak   = toDb(std::max((double)m_truePeak, m_samplePeak / 32768.));
+
+    // Integrated, two pass gating
+    double sum = 0.;
+    size_t count = 0;
+    double maxMomentary = 0.;
+    for (std::vector<double>::const_iterator it = m_momentary.begin(); it != m_momentary.end(); ++it)
+    {
+        maxMomentary = std::max(maxMomentary, *it);
+        if (loudness(*it) > ABSOLUTE_GATE)
+        {
+            sum += *it;
+            count++;
+        }
+    }
+    m_result.maxMomentary = loudness(maxMomentary);
+    m_result.integrated = -HUGE_VAL;
+    if (count)
+    {
+        const double gate = meanSquare(loudness(sum / count) + RELATIVE_GATE);
+        sum = 0.;
+        count = 0;
+        for (std::vector<double>::const_iterator it = m_momentary.begin(); it != m_momentary.end(); ++it)
+        {
+            if ((loudness(*it) > ABSOLUTE_GATE) && (*it > gate))
+            {
+                sum += *it;
+                count++;
+            }
+        }
+        if (count)
+            m_result.integrated = loudness(sum / count);
+    }
+
+    // Loudness range, EBU Tech 3342
+    sum = 0.;
+    count = 0;
+    double maxShortTerm = 0.;
+    for (std::vector<double>::const_iterator it = m_shortTerm.begin(); it != m_shortTerm.end(); ++it)
+    {
+        maxShortTerm = std::max(maxShortTerm, *it);
+        if (loudness(*it) > ABSOLUTE_GATE)
+        {
+            sum += *it;
+            count++;
+        }
+    }
+    m_result.maxShortTerm = loudness(maxShortTerm);
+    m_result.range = 0.;
+    if (count)
+    {
+        const double gate = loudness(sum / count) + RANGE_GATE;
+        std::vector<double> values;
+        for (std::vector<double>::const_iterator it = m_shortTerm.begin(); it != m_shortTerm.end(); ++it)
+        {
+            const double l = loudness(*it);
+            if ((l > ABSOLUTE_GATE) && (l > gate))
+                values.push_back(l);
+        }
+        if (!values.empty())
+        {
+            std::sort(values.begin(), values.end());
+            m_result.range = percentile(values, 0.95) - percentile(values, 0.10);
+        }
+    }
+}
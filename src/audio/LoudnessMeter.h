@@ -0,0 +1,109 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * EBU R128 loudness and peak meter, fed with the
+ * interleaved 16 bit samples as they are written.
+ *
+ * The K-weighting filters run in double precision with
+ * a pair of channels per SIMD register; the true peak is
+ * found by oversampling with a polyphase filter whose
+ * phases sit in the lanes of a SIMD register. Only the
+ * 100 ms block energies are kept, so memory grows by a
+ * few bytes per second of audio.
+ */
+class LoudnessMeter
+{
+public:
+    struct result_t
+    {
+        double integrated;      // LUFS
+        double range;           // LU
+        double truePeak;        // dBTP
+        double samplePeak;      // dBFS
+        double maxMomentary;    // LUFS
+        double maxShortTerm;    // LUFS
+        uint_least64_t clipped; // samples at full scale
+        uint_least64_t frames;
+    };
+
+private:
+    unsigned int m_channels;
+    unsigned int m_rate;
+    unsigned int m_oversample;
+
+    // K-weighting, shelf and high pass biquads
+    double m_coeffs[2][5];
+    std::vector<double> m_state; // 4 per channel
+
+    // 100 ms steps, momentary blocks are 4 steps
+    // and short term blocks 30 steps long
+    uint_least32_t      m_stepFrames;
+    uint_least32_t      m_stepFill;
+    double              m_stepEnergy;
+    std::vector<double> m_steps; // ring of the last 30 steps
+    uint_least64_t      m_stepCount;
+
+    std::vector<double> m_momentary; // mean square of each block
+    std::vector<double> m_shortTerm;
+
+    // True peak
+    std::vector<float> m_peakCoeffs; // 4 lanes per tap
+    std::vector<std::vector<float> > m_history;
+    float m_truePeak;
+
+    int m_samplePeak;
+    uint_least64_t m_clipped;
+    uint_least64_t m_frames;
+
+    result_t m_result;
+
+private:
+    void step();
+
+public:
+    LoudnessMeter();
+
+    // Returns false for more than 4 channels
+    bool setup(unsigned int rate, unsigned int channels);
+
+    // Throws std::bad_alloc
+    void process(const short *in, size_t frames);
+
+    // Compute the results from what was processed so far
+    void finish();
+
+    const result_t &result() const { return m_result; }
+
+    // Loudness of silence, gated out
+    static bool silent(double lufs) { return lufs < -70.; }
+
+    // Name of the instruction set used by the kernels
+    static const char *simd();
+};
+
+#endif // LOUDNESSMETER_H
@@ -0,0 +1,352 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "Resampler.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <new>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#  define RESAMPLE_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__)
+#    define RESAMPLE_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define RESAMPLE_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace
+{
+
+// Filter length at unity ratio, longer when decimating
+const unsigned int BASE_TAPS = 64;
+
+// Most phases accepted, enough for 44100 <-> 96000
+const unsigned int MAX_PHASES = 1024;
+
+// Kaiser window shape, about 90 dB of stopband attenuation
+const double KAISER_BETA = 9.0;
+
+// Cutoff relative to the lower Nyquist frequency
+const double CUTOFF = 0.91;
+
+const double PI = 3.14159265358979323846;
+
+// Kernels work on lengths multiple of 8
+
+typedef float (*dot_t)(const float *a, const float *b, size_t n);
+
+float dotScalar(const float *a, const float *b, size_t n)
+{
+    float sum[4] = { 0.f, 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < n; i += 4)
+    {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#ifdef RESAMPLE_SSE2
+
+float dotSSE2(const float *a, const float *b, size_t n)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    sum0 = _mm_add_ps(sum0, sum1);
+    sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+    sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+    return _mm_cvtss_f32(sum0);
+}
+
+#endif // RESAMPLE_SSE2
+
+#ifdef RESAMPLE_AVX2
+
+__attribute__((target("avx2")))
+float dotAVX2(const float *a, const float *b, size_t n)
+{
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < n; i += 8)
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+#endif // RESAMPLE_AVX2
+
+#ifdef RESAMPLE_NEON
+
+float dotNEON(const float *a, const float *b, size_t n)
+{
+    float32x4_t sum0 = vdupq_n_f32(0.f);
+    float32x4_t sum1 = vdupq_n_f32(0.f);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    const float32x4_t sum = vaddq_f32(sum0, sum1);
+    const float32x2_t s = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+#endif // RESAMPLE_NEON
+
+enum simd_t
+{
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_NEON
+};
+
+simd_t detectSimd()
+{
+#if defined(RESAMPLE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+#endif
+#if defined(RESAMPLE_SSE2)
+    return SIMD_SSE2;
+#elif defined(RESAMPLE_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+const simd_t cpuSimd = detectSimd();
+
+dot_t selectKernel()
+{
+    switch (cpuSimd)
+    {
+#ifdef RESAMPLE_AVX2
+    case SIMD_AVX2: return dotAVX2;
+#endif
+#ifdef RESAMPLE_SSE2
+    case SIMD_SSE2: return dotSSE2;
+#endif
+#ifdef RESAMPLE_NEON
+    case SIMD_NEON: return dotNEON;
+#endif
+    default:        return dotScalar;
+    }
+}
+
+const dot_t dot = selectKernel();
+
+unsigned int gcd(unsigned int a, unsigned int b)
+{
+    while (b)
+    {
+        const unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Zeroth order modified Bessel function, for the Kaiser window
+double besselI0(double x)
+{
+    double sum = 1.;
+    double term = 1.;
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (x / (2. * k)) * (x / (2. * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+inline short clamp(float sample)
+{
+    const long s = std::lrint(sample);
+    return (s > 32767) ? 32767 : (s < -32768) ? -32768 : static_cast<short>(s);
+}
+
+}
+
+Resampler::Resampler() :
+    m_channels(0),
+    m_up(1),
+    m_down(1),
+    m_taps(0),
+    m_pos(0),
+    m_phase(0),
+    m_inFrames(0),
+    m_outFrames(0),
+    m_finished(false) {}
+
+const char *Resampler::simd()
+{
+    switch (cpuSimd)
+    {
+    case SIMD_SSE2: return "SSE2";
+    case SIMD_AVX2: return "AVX2";
+    case SIMD_NEON: return "NEON";
+    default:        return "none";
+    }
+}
+
+bool Resampler::setup(unsigned int inRate, unsigned int outRate, unsigned int channels)
+{
+    if (!inRate || !outRate || !channels)
+        return false;
+
+    const unsigned int div = gcd(inRate, outRate);
+    m_up   = outRate / div;
+    m_down = inRate / div;
+    if (m_up > MAX_PHASES)
+        return false;
+
+    m_channels = channels;
+
+    // Longer filter when decimating to keep the same transition band,
+    // a multiple of 8 for the kernels
+    const double ratio = (inRate > outRate) ? (double)inRate / outRate : 1.;
+    m_taps = ((unsigned int)std::ceil(BASE_TAPS * ratio) + 7) & ~7u;
+
+    // Cutoff in cycles per input sample
+    const double fc = 0.5 * CUTOFF * ((outRate < inRate) ? (double)outRate / inRate : 1.);
+    const double half = m_taps / 2;
+    const double norm = besselI0(KAISER_BETA);
+
+    try
+    {
+        m_coeffs.resize((size_t)m_up * m_taps);
+        m_history.assign(channels, std::vector<float>());
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+
+    // Phase p gives the output sample p/m_up of an input
+    // sample past the middle of the filter
+    for (unsigned int p = 0; p < m_up; p++)
+    {
+        float *h = &m_coeffs[(size_t)p * m_taps];
+        double sum = 0.;
+        for (unsigned int k = 0; k < m_taps; k++)
+        {
+            const double x = (double)k - (half - 1.) - (double)p / m_up;
+            const double t = x / half;
+            const double w = (t * t < 1.) ? besselI0(KAISER_BETA * std::sqrt(1. - t * t)) / norm : 0.;
+            const double s = (x == 0.) ? 2. * fc : std::sin(2. * PI * fc * x) / (PI * x);
+            h[k] = (float)(s * w);
+            sum += h[k];
+        }
+        // Unity gain at DC for every phase
+        for (unsigned int k = 0; k < m_taps; k++)
+            h[k] = (float)(h[k] / sum);
+    }
+
+    reset();
+    return true;
+}
+
+void Resampler::reset()
+{
+    // Zeros ahead so the first output lines up with the first input
+    for (std::vector<std::vector<float> >::iterator it = m_history.begin(); it != m_history.end(); ++it)
+        it->assign(m_taps / 2 - 1, 0.f);
+
+    m_pos       = 0;
+    m_phase     = 0;
+    m_inFrames  = 0;
+    m_outFrames = 0;
+    m_finished  = false;
+}
+
+void Resampler::push(const short *in, size_t frames)
+{
+    for (unsigned int c = 0; c < m_channels; c++)
+    {
+        std::vector<float> &history = m_history[c];
+        history.erase(history.begin(), history.begin() + m_pos);
+        for (size_t i = 0; i < frames; i++)
+            history.push_back(in[i * m_channels + c]);
+    }
+    m_pos = 0;
+    m_inFrames += frames;
+}
+
+void Resampler::finish()
+{
+    if (m_finished)
+        return;
+
+    for (std::vector<std::vector<float> >::iterator it = m_history.begin(); it != m_history.end(); ++it)
+        it->insert(it->end(), m_taps / 2, 0.f);
+    m_finished = true;
+}
+
+size_t Resampler::pull(short *out, size_t maxFrames)
+{
+    if (!m_channels)
+        return 0;
+
+    // Outputs up to the end of the input, rounded up
+    const uint_least64_t total = (m_inFrames * m_up + m_down - 1) / m_down;
+
+    const size_t available = m_history[0].size();
+    size_t frames = 0;
+    while ((frames < maxFrames) && (m_pos + m_taps <= available))
+    {
+        if (m_finished && (m_outFrames >= total))
+            break;
+
+        const float *h = &m_coeffs[(size_t)m_phase * m_taps];
+        for (unsigned int c = 0; c < m_channels; c++)
+            *out++ = clamp(dot(h, &m_history[c][m_pos], m_taps));
+
+        frames++;
+        m_outFrames++;
+
+        m_phase += m_down;
+        m_pos   += m_phase / m_up;
+        m_phase %= m_up;
+    }
+    return frames;
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Polyphase windowed sinc resampler for interleaved
+ * 16 bit samples, between rates with a small ratio
+ * such as 44100, 48000 and 96000 Hz.
+ *
+ * Samples are kept as float, one history per channel,
+ * and each output sample is the dot product of one
+ * phase of the filter with the history. The dot product
+ * has SIMD kernels picked at runtime like the ones of
+ * the sample converter.
+ */
+class Resampler
+{
+private:
+    unsigned int m_channels;
+    unsigned int m_up;
+    unsigned int m_down;
+    unsigned int m_taps;
+
+    std::vector<float> m_coeffs; // m_up phases of m_taps each
+    std::vector<std::vector<float> > m_history;
+
+    size_t         m_pos;   // first history sample of the next output
+    unsigned int   m_phase;
+    uint_least64_t m_inFrames;
+    uint_least64_t m_outFrames;
+    bool           m_finished;
+
+public:
+    Resampler();
+
+    // Build the filter, returns false if the ratio
+    // needs too many phases or when out of memory
+    bool setup(unsigned int inRate, unsigned int outRate, unsigned int channels);
+
+    // Drop the history and start over
+    void reset();
+
+    // Queue input frames. Throws std::bad_alloc
+    void push(const short *in, size_t frames);
+
+    // Flush the filter at the end of the input, the output
+    // then matches the length of the input exactly
+    void finish();
+
+    // Get up to maxFrames output frames, returns how many
+    size_t pull(short *out, size_t maxFrames);
+
+    // Name of the instruction set used by the kernels
+    static const char *simd();
+};
+
+#endif // RESAMPLER_H
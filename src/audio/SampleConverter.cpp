@@ -0,0 +1,415 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "SampleConverter.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <new>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#  define CONVERT_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__)
+#    define CONVERT_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(WORDS_BIGENDIAN)
+#  define CONVERT_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace
+{
+
+const float SCALE = 1.f / 32768.f;
+
+// Scalar kernels, they write bytes explicitly so they
+// work on any host and serve the tails of SIMD loops
+
+template<SampleConverter::format_t F>
+inline void store(uint8_t *out, short sample);
+
+template<>
+inline void store<SampleConverter::S16_LE>(uint8_t *out, short sample)
+{
+    const uint_least16_t s = static_cast<uint_least16_t>(sample);
+    out[0] = static_cast<uint8_t>(s);
+    out[1] = static_cast<uint8_t>(s >> 8);
+}
+
+template<>
+inline void store<SampleConverter::S16_BE>(uint8_t *out, short sample)
+{
+    const uint_least16_t s = static_cast<uint_least16_t>(sample);
+    out[0] = static_cast<uint8_t>(s >> 8);
+    out[1] = static_cast<uint8_t>(s);
+}
+
+template<>
+inline void store<SampleConverter::S24_LE>(uint8_t *out, short sample)
+{
+    const uint_least16_t s = static_cast<uint_least16_t>(sample);
+    out[0] = 0;
+    out[1] = static_cast<uint8_t>(s);
+    out[2] = static_cast<uint8_t>(s >> 8);
+}
+
+template<>
+inline void store<SampleConverter::S24_BE>(uint8_t *out, short sample)
+{
+    const uint_least16_t s = static_cast<uint_least16_t>(sample);
+    out[0] = static_cast<uint8_t>(s >> 8);
+    out[1] = static_cast<uint8_t>(s);
+    out[2] = 0;
+}
+
+inline uint32_t floatBits(short sample)
+{
+    const float f = static_cast<float>(sample) * SCALE;
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+template<>
+inline void store<SampleConverter::F32_LE>(uint8_t *out, short sample)
+{
+    const uint32_t bits = floatBits(sample);
+    out[0] = static_cast<uint8_t>(bits);
+    out[1] = static_cast<uint8_t>(bits >> 8);
+    out[2] = static_cast<uint8_t>(bits >> 16);
+    out[3] = static_cast<uint8_t>(bits >> 24);
+}
+
+template<>
+inline void store<SampleConverter::F32_BE>(uint8_t *out, short sample)
+{
+    const uint32_t bits = floatBits(sample);
+    out[0] = static_cast<uint8_t>(bits >> 24);
+    out[1] = static_cast<uint8_t>(bits >> 16);
+    out[2] = static_cast<uint8_t>(bits >> 8);
+    out[3] = static_cast<uint8_t>(bits);
+}
+
+template<SampleConverter::format_t F>
+inline size_t width();
+
+template<> inline size_t width<SampleConverter::S16_LE>() { return 2; }
+template<> inline size_t width<SampleConverter::S16_BE>() { return 2; }
+template<> inline size_t width<SampleConverter::S24_LE>() { return 3; }
+template<> inline size_t width<SampleConverter::S24_BE>() { return 3; }
+template<> inline size_t width<SampleConverter::F32_LE>() { return 4; }
+template<> inline size_t width<SampleConverter::F32_BE>() { return 4; }
+
+template<SampleConverter::format_t F>
+void convertScalar(const short *in, uint8_t *out, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+        store<F>(out + i * width<F>(), in[i]);
+}
+
+#ifdef CONVERT_SSE2
+
+inline __m128i swap16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+inline __m128i swap32(__m128i v)
+{
+    return swap16(_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1));
+}
+
+void s16beSSE2(const short *in, uint8_t *out, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), swap16(v));
+    }
+    convertScalar<SampleConverter::S16_BE>(in + i, out + i * 2, samples - i);
+}
+
+template<bool BE>
+void f32SSE2(const short *in, uint8_t *out, size_t samples)
+{
+    const __m128 scale = _mm_set1_ps(SCALE);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign extend by placing the sample in the high half
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        __m128i flo = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        __m128i fhi = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        if (BE)
+        {
+            flo = swap32(flo);
+            fhi = swap32(fhi);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), flo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4 + 16), fhi);
+    }
+    if (BE)
+        convertScalar<SampleConverter::F32_BE>(in + i, out + i * 4, samples - i);
+    else
+        convertScalar<SampleConverter::F32_LE>(in + i, out + i * 4, samples - i);
+}
+
+#endif // CONVERT_SSE2
+
+#ifdef CONVERT_AVX2
+
+__attribute__((target("avx2")))
+void s16beAVX2(const short *in, uint8_t *out, size_t samples)
+{
+    const __m256i mask = _mm256_setr_epi8(
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+        1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2), _mm256_shuffle_epi8(v, mask));
+    }
+    convertScalar<SampleConverter::S16_BE>(in + i, out + i * 2, samples - i);
+}
+
+template<bool BE>
+__attribute__((target("avx2")))
+void f32AVX2(const short *in, uint8_t *out, size_t samples)
+{
+    const __m256 scale = _mm256_set1_ps(SCALE);
+    const __m256i mask = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m256i f = _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), scale));
+        if (BE)
+            f = _mm256_shuffle_epi8(f, mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), f);
+    }
+    if (BE)
+        convertScalar<SampleConverter::F32_BE>(in + i, out + i * 4, samples - i);
+    else
+        convertScalar<SampleConverter::F32_LE>(in + i, out + i * 4, samples - i);
+}
+
+#endif // CONVERT_AVX2
+
+#ifdef CONVERT_NEON
+
+void s16beNEON(const short *in, uint8_t *out, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const uint8x16_t v = vreinterpretq_u8_s16(vld1q_s16(in + i));
+        vst1q_u8(out + i * 2, vrev16q_u8(v));
+    }
+    convertScalar<SampleConverter::S16_BE>(in + i, out + i * 2, samples - i);
+}
+
+template<bool BE>
+void f32NEON(const short *in, uint8_t *out, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        const int16x8_t v = vld1q_s16(in + i);
+        const float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), SCALE);
+        const float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), SCALE);
+        uint8x16_t blo = vreinterpretq_u8_f32(lo);
+        uint8x16_t bhi = vreinterpretq_u8_f32(hi);
+        if (BE)
+        {
+            blo = vrev32q_u8(blo);
+            bhi = vrev32q_u8(bhi);
+        }
+        vst1q_u8(out + i * 4, blo);
+        vst1q_u8(out + i * 4 + 16, bhi);
+    }
+    if (BE)
+        convertScalar<SampleConverter::F32_BE>(in + i, out + i * 4, samples - i);
+    else
+        convertScalar<SampleConverter::F32_LE>(in + i, out + i * 4, samples - i);
+}
+
+#endif // CONVERT_NEON
+
+enum simd_t
+{
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_NEON
+};
+
+simd_t detectSimd()
+{
+#if defined(CONVERT_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+#endif
+#if defined(CONVERT_SSE2)
+    return SIMD_SSE2;
+#elif defined(CONVERT_NEON)
+    return SIMD_NEON;
+#else
+    return SIMD_NONE;
+#endif
+}
+
+const simd_t cpuSimd = detectSimd();
+
+SampleConverter::kernel_t selectKernel(SampleConverter::format_t format)
+{
+    switch (format)
+    {
+    case SampleConverter::S16_BE:
+#ifdef CONVERT_AVX2
+        if (cpuSimd == SIMD_AVX2)
+            return s16beAVX2;
+#endif
+#ifdef CONVERT_SSE2
+        return s16beSSE2;
+#endif
+#ifdef CONVERT_NEON
+        return s16beNEON;
+#endif
+        return convertScalar<SampleConverter::S16_BE>;
+    case SampleConverter::F32_LE:
+#ifdef CONVERT_AVX2
+        if (cpuSimd == SIMD_AVX2)
+            return f32AVX2<false>;
+#endif
+#ifdef CONVERT_SSE2
+        return f32SSE2<false>;
+#endif
+#ifdef CONVERT_NEON
+        return f32NEON<false>;
+#endif
+        return convertScalar<SampleConverter::F32_LE>;
+    case SampleConverter::F32_BE:
+#ifdef CONVERT_AVX2
+        if (cpuSimd == SIMD_AVX2)
+            return f32AVX2<true>;
+#endif
+#ifdef CONVERT_SSE2
+        return f32SSE2<true>;
+#endif
+#ifdef CONVERT_NEON
+        return f32NEON<true>;
+#endif
+        return convertScalar<SampleConverter::F32_BE>;
+    // 24 bit is only byte shuffling, left to the compiler
+    case SampleConverter::S24_LE:
+        return convertScalar<SampleConverter::S24_LE>;
+    case SampleConverter::S24_BE:
+        return convertScalar<SampleConverter::S24_BE>;
+    case SampleConverter::S16_LE:
+    default:
+        return convertScalar<SampleConverter::S16_LE>;
+    }
+}
+
+}
+
+SampleConverter::SampleConverter() :
+    m_format(S16_LE),
+    m_kernel(nullptr) {}
+
+size_t SampleConverter::bytesPerSample(format_t format)
+{
+    switch (format)
+    {
+    case S24_LE:
+    case S24_BE:
+        return 3;
+    case F32_LE:
+    case F32_BE:
+        return 4;
+    default:
+        return 2;
+    }
+}
+
+const char *SampleConverter::simd()
+{
+    switch (cpuSimd)
+    {
+    case SIMD_SSE2: return "SSE2";
+    case SIMD_AVX2: return "AVX2";
+    case SIMD_NEON: return "NEON";
+    default:        return "none";
+    }
+}
+
+bool SampleConverter::setup(format_t format, size_t maxSamples)
+{
+    m_format = format;
+
+#ifdef WORDS_BIGENDIAN
+    const bool native = (format == S16_BE);
+#else
+    const bool native = (format == S16_LE);
+#endif
+
+    // Host order 16 bit samples are written as they are
+    if (native)
+    {
+        m_kernel = nullptr;
+        m_scratch.clear();
+        return true;
+    }
+
+    m_kernel = selectKernel(format);
+
+    try
+    {
+        m_scratch.resize(maxSamples * bytesPerSample(format));
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        return false;
+    }
+    return true;
+}
+
+const void *SampleConverter::convert(const short *in, size_t samples)
+{
+    if (m_kernel == nullptr)
+        return in;
+
+    m_kernel(in, m_scratch.data(), samples);
+    return m_scratch.data();
+}
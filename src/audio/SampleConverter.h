@@ -0,0 +1,77 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SAMPLECONVERTER_H
+#define SAMPLECONVERTER_H
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Converts the 16 bit host order samples produced by the
+ * engine into the sample format of a file or stream.
+ *
+ * Each format has its own kernel, the fastest one the CPU
+ * supports is picked once at runtime. Converted samples go
+ * into a scratch buffer allocated up front, so converting
+ * never allocates.
+ */
+class SampleConverter
+{
+public:
+    enum format_t
+    {
+        S16_LE,
+        S16_BE,
+        S24_LE,
+        S24_BE,
+        F32_LE,
+        F32_BE
+    };
+
+    typedef void (*kernel_t)(const short *in, uint8_t *out, size_t samples);
+
+private:
+    format_t m_format;
+    kernel_t m_kernel;
+    std::vector<uint8_t> m_scratch;
+
+public:
+    SampleConverter();
+
+    // Select the output format and allocate room for up to
+    // maxSamples samples, returns false when out of memory
+    bool setup(format_t format, size_t maxSamples);
+
+    // Convert samples, the result is valid until the next call.
+    // Returns the input itself when it's already in the right format.
+    const void *convert(const short *in, size_t samples);
+
+    size_t bytesPerSample() const { return bytesPerSample(m_format); }
+    format_t format() const { return m_format; }
+
+    static size_t bytesPerSample(format_t format);
+
+    // Name of the instruction set used by the kernels
+    static const char *simd();
+};
+
+#endif // SAMPLECONVERTER_H
@@ -0,0 +1,284 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "SilenceDetector.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#  define SILENCE_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+#  define SILENCE_NEON
+#  include <arm_neon.h>
+#endif
+
+namespace
+{
+
+// Windows per second
+const unsigned int WINDOW_RATE = 20;
+
+// Peaks may be this much above the RMS threshold, in dB
+const double CREST_FACTOR = 12.;
+
+typedef SilenceDetector::stats_t stats_t;
+
+// Sample i goes to lane i % lanes
+void statsScalar(const short *in, size_t samples, unsigned int lanes, stats_t &s)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        const unsigned int lane = i % lanes;
+        const int v = in[i];
+        s.sum[lane] += v;
+        s.squares += (uint_least64_t)(v * v);
+        s.min[lane] = std::min<short>(s.min[lane], v);
+        s.max[lane] = std::max<short>(s.max[lane], v);
+    }
+}
+
+// The SIMD kernels use all eight lanes
+
+#ifdef SILENCE_SSE2
+
+size_t statsSSE2(const short *in, size_t samples, stats_t &s)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i min = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.min));
+    __m128i max = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.max));
+    __m128i sq  = zero;
+
+    size_t i = 0;
+    while (i + 8 <= samples)
+    {
+        // Keep the 32 bit sums from overflowing
+        const size_t end = std::min(samples - ((samples - i) % 8), i + 8 * 32768);
+        __m128i sumLo = zero;
+        __m128i sumHi = zero;
+        for (; i < end; i += 8)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            sumLo = _mm_add_epi32(sumLo, _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+            sumHi = _mm_add_epi32(sumHi, _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+            // Pairs of squares fit 32 bits unsigned
+            const __m128i p = _mm_madd_epi16(v, v);
+            sq  = _mm_add_epi64(sq, _mm_add_epi64(_mm_unpacklo_epi32(p, zero), _mm_unpackhi_epi32(p, zero)));
+            min = _mm_min_epi16(min, v);
+            max = _mm_max_epi16(max, v);
+        }
+
+        int32_t sums[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sumLo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + 4), sumHi);
+        for (unsigned int l = 0; l < 8; l++)
+            s.sum[l] += sums[l];
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s.min), min);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s.max), max);
+    uint64_t squares[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(squares), sq);
+    s.squares += squares[0] + squares[1];
+    return i;
+}
+
+#endif // SILENCE_SSE2
+
+#ifdef SILENCE_NEON
+
+size_t statsNEON(const short *in, size_t samples, stats_t &s)
+{
+    int16x8_t min = vld1q_s16(s.min);
+    int16x8_t max = vld1q_s16(s.max);
+    uint64x2_t sq = vdupq_n_u64(0);
+
+    size_t i = 0;
+    while (i + 8 <= samples)
+    {
+        // Keep the 32 bit sums from overflowing
+        const size_t end = std::min(samples - ((samples - i) % 8), i + 8 * 32768);
+        int32x4_t sumLo = vdupq_n_s32(0);
+        int32x4_t sumHi = vdupq_n_s32(0);
+        for (; i < end; i += 8)
+        {
+            const int16x8_t v = vld1q_s16(in + i);
+            sumLo = vaddw_s16(sumLo, vget_low_s16(v));
+            sumHi = vaddw_s16(sumHi, vget_high_s16(v));
+            sq = vpadalq_u32(sq, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(v), vget_low_s16(v))));
+            sq = vpadalq_u32(sq, vreinterpretq_u32_s32(vmull_s16(vget_high_s16(v), vget_high_s16(v))));
+            min = vminq_s16(min, v);
+            max = vmaxq_s16(max, v);
+        }
+
+        int32_t sums[8];
+        vst1q_s32(sums, sumLo);
+        vst1q_s32(sums + 4, sumHi);
+        for (unsigned int l = 0; l < 8; l++)
+            s.sum[l] += sums[l];
+    }
+
+    vst1q_s16(s.min, min);
+    vst1q_s16(s.max, max);
+    s.squares += vgetq_lane_u64(sq, 0) + vgetq_lane_u64(sq, 1);
+    return i;
+}
+
+#endif // SILENCE_NEON
+
+}
+
+SilenceDetector::SilenceDetector() :
+    m_channels(1),
+    m_lanes(LANES),
+    m_windowFrames(1),
+    m_holdWindows(1),
+    m_rmsLimit(0.),
+    m_peakLimit(0.)
+{
+    reset();
+}
+
+const char *SilenceDetector::simd()
+{
+#if defined(SILENCE_SSE2)
+    return "SSE2";
+#elif defined(SILENCE_NEON)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
+bool SilenceDetector::setup(unsigned int rate, unsigned int channels, double threshold, uint_least32_t hold)
+{
+    if (!rate || !channels || (channels > LANES))
+        return false;
+
+    m_channels     = channels;
+    m_lanes        = (LANES % channels == 0) ? LANES : channels;
+    m_windowFrames = std::max(1u, rate / WINDOW_RATE);
+    m_holdWindows  = std::max<uint_least32_t>(1, (uint_least32_t)(((uint_least64_t)hold * WINDOW_RATE + 999) / 1000));
+    m_rmsLimit     = 32768. * std::pow(10., threshold / 20.);
+    m_peakLimit    = 32768. * std::pow(10., (threshold + CREST_FACTOR) / 20.);
+
+    reset();
+    return true;
+}
+
+void SilenceDetector::reset()
+{
+    for (unsigned int l = 0; l < LANES; l++)
+    {
+        m_stats.sum[l] = 0;
+        m_stats.min[l] = 32767;
+        m_stats.max[l] = -32768;
+    }
+    m_stats.squares = 0;
+    m_fill          = 0;
+    m_frames        = 0;
+    m_quietStart    = 0;
+    m_quietWindows  = 0;
+    m_ended         = false;
+}
+
+// A window is complete
+void SilenceDetector::window()
+{
+    const double n = m_windowFrames;
+
+    // Fold the lanes into the channels
+    double energy = (double)m_stats.squares;
+    double peak = 0.;
+    for (unsigned int c = 0; c < m_channels; c++)
+    {
+        int_least64_t sum = 0;
+        int min = 32767;
+        int max = -32768;
+        for (unsigned int l = c; l < m_lanes; l += m_channels)
+        {
+            sum += m_stats.sum[l];
+            min = std::min<int>(min, m_stats.min[l]);
+            max = std::max<int>(max, m_stats.max[l]);
+        }
+        const double mean = sum / n;
+        energy -= sum * mean;
+        peak = std::max(peak, std::max(max - mean, mean - min));
+    }
+    const double rms = std::sqrt(std::max(0., energy) / (n * m_channels));
+
+    if ((rms < m_rmsLimit) && (peak < m_peakLimit))
+    {
+        if (m_quietWindows++ == 0)
+            m_quietStart = m_frames;
+        if (m_quietWindows >= m_holdWindows)
+            m_ended = true;
+    }
+    else
+    {
+        m_quietWindows = 0;
+    }
+
+    m_frames += m_windowFrames;
+
+    for (unsigned int l = 0; l < LANES; l++)
+    {
+        m_stats.sum[l] = 0;
+        m_stats.min[l] = 32767;
+        m_stats.max[l] = -32768;
+    }
+    m_stats.squares = 0;
+    m_fill = 0;
+}
+
+bool SilenceDetector::process(const short *in, size_t frames)
+{
+    while (frames && !m_ended)
+    {
+        const size_t n = std::min<size_t>(frames, m_windowFrames - m_fill);
+        const size_t samples = n * m_channels;
+
+        size_t done = 0;
+        if (m_lanes == LANES)
+        {
+#if defined(SILENCE_SSE2)
+            done = statsSSE2(in, samples, m_stats);
+#elif defined(SILENCE_NEON)
+            done = statsNEON(in, samples, m_stats);
+#endif
+        }
+        // Whole vectors are whole frames, the lanes stay in step
+        statsScalar(in + done, samples - done, m_lanes, m_stats);
+
+        in     += samples;
+        frames -= n;
+        m_fill += n;
+        if (m_fill == m_windowFrames)
+            window();
+    }
+    return m_ended;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SILENCEDETECTOR_H
+#define SILENCEDETECTOR_H
+
+#include <cstddef>
+#include <stdint.h>
+
+/*
+ * Finds where the music ends: the output stays below a level
+ * for a given time, either silent or faded out.
+ *
+ * The samples are checked in 50 ms windows. A window is quiet
+ * when both its RMS and its peak, measured around the mean of
+ * each channel so that the DC offset of the SID output does not
+ * count, are below the threshold; the peak is allowed 12 dB
+ * more for the crest factor. The sums are taken over the
+ * interleaved samples with SIMD kernels.
+ */
+class SilenceDetector
+{
+public:
+    static const unsigned int LANES = 8;
+
+    struct stats_t
+    {
+        int_least64_t  sum[LANES];
+        short          min[LANES];
+        short          max[LANES];
+        uint_least64_t squares;     // all lanes
+    };
+
+private:
+    unsigned int   m_channels;
+    unsigned int   m_lanes;         // lanes of the sums, a multiple of the channels
+    uint_least32_t m_windowFrames;
+    uint_least32_t m_holdWindows;
+    double         m_rmsLimit;      // sample units
+    double         m_peakLimit;
+
+    stats_t        m_stats;
+    uint_least32_t m_fill;          // frames in the current window
+
+    uint_least64_t m_frames;        // frames of the finished windows
+    uint_least64_t m_quietStart;
+    uint_least32_t m_quietWindows;
+    bool           m_ended;
+
+private:
+    void window();
+
+public:
+    SilenceDetector();
+
+    // Threshold in dBFS, hold time in milliseconds
+    bool setup(unsigned int rate, unsigned int channels, double threshold, uint_least32_t hold);
+
+    // Start over, e.g. for a new song
+    void reset();
+
+    // Check some frames, returns true once the music has ended
+    bool process(const short *in, size_t frames);
+
+    bool ended() const { return m_ended; }
+
+    // Frame where the quiet part that ended the music begins
+    uint_least64_t endFrame() const { return m_quietStart; }
+
+    // Name of the instruction set used by the kernels
+    static const char *simd();
+};
+
+#endif // SILENCEDETECTOR_H
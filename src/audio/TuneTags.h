@@ -0,0 +1,68 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef TUNE_TAGS_H
+#define TUNE_TAGS_H
+
+#include <string>
+
+/*
+ * Tune info strings for the formats storing
+ * tags as UTF-8 comments, e.g. FLAC and Opus.
+ */
+struct TuneTags
+{
+    std::string title;
+    std::string author;
+    std::string released;
+    bool valid;
+
+    TuneTags() : valid(false) {}
+
+    // Strings are Latin-1 as in the tune info
+    void set(const char* title, const char* author, const char* released)
+    {
+        valid = true;
+        this->title    = utf8(title);
+        this->author   = utf8(author);
+        this->released = utf8(released);
+    }
+
+    static std::string utf8(const char *str)
+    {
+        std::string out;
+        for (; *str; str++)
+        {
+            const unsigned char c = *str;
+            if (c < 0x80)
+            {
+                out.push_back(c);
+            }
+            else
+            {
+                out.push_back(0xc0 | (c >> 6));
+                out.push_back(0x80 | (c & 0x3f));
+            }
+        }
+        return out;
+    }
+};
+
+#endif // TUNE_TAGS_H
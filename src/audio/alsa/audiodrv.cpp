@@ -25,6 +25,8 @@
 
 #include <new>
 
+#include <cerrno>
+
 Audio_ALSA::Audio_ALSA() :
     AudioBase("ALSA")
 {
@@ -42,6 +44,10 @@ void Audio_ALSA::outOfOrder()
     // Reset everything.
     clearError();
     _audioHandle = nullptr;
+    _mmap = false;
+    _mmapBuffer = nullptr;
+    _delay = 0;
+    _underruns = 0;
 }
 
 void Audio_ALSA::checkResult(int err)
@@ -63,7 +69,8 @@ bool Audio_ALSA::open(AudioConfig &cfg)
             throw error("Device already in use");
         }
 
-        checkResult(snd_pcm_open(&_audioHandle, "default", SND_PCM_STREAM_PLAYBACK, 0));
+        const char *device = cfg.device.empty() ? "default" : cfg.device.c_str();
+        checkResult(snd_pcm_open(&_audioHandle, device, SND_PCM_STREAM_PLAYBACK, 0));
 
         // May later be replaced with driver defaults.
         AudioConfig tmpCfg = cfg;
@@ -72,9 +79,14 @@ bool Audio_ALSA::open(AudioConfig &cfg)
 
         checkResult(snd_pcm_hw_params_any(_audioHandle, hw_params));
 
-        checkResult(snd_pcm_hw_params_set_access(_audioHandle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED));
+        // Prefer mmap access so the engine renders straight
+        // into the device ring, not all devices support it
+        _mmap = snd_pcm_hw_params_set_access(_audioHandle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) >= 0;
+        if (!_mmap)
+            checkResult(snd_pcm_hw_params_set_access(_audioHandle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED));
 
-        checkResult(snd_pcm_hw_params_set_format(_audioHandle, hw_params, SND_PCM_FORMAT_S16_LE));
+        // Samples are in host byte order
+        checkResult(snd_pcm_hw_params_set_format(_audioHandle, hw_params, SND_PCM_FORMAT_S16));
 
         checkResult(snd_pcm_hw_params_set_channels(_audioHandle, hw_params, tmpCfg.channels));
 
@@ -83,17 +95,56 @@ bool Audio_ALSA::open(AudioConfig &cfg)
             checkResult(snd_pcm_hw_params_set_rate_near(_audioHandle, hw_params, &rate, 0));
         }
 
-        _alsa_to_frames_divisor = tmpCfg.channels;
-        snd_pcm_uframes_t buffer_frames = 4096;
-        checkResult(snd_pcm_hw_params_set_period_size_near(_audioHandle, hw_params, &buffer_frames, 0));
+        // Buffer time first, period size and count are then
+        // fitted into it. With no settings at all keep the old
+        // 4096 frames period and the driver's buffer size.
+        if (tmpCfg.bufferTime)
+        {
+            unsigned int bufferTime = tmpCfg.bufferTime;
+            checkResult(snd_pcm_hw_params_set_buffer_time_near(_audioHandle, hw_params, &bufferTime, 0));
+        }
+
+        if (tmpCfg.periodSize || !(tmpCfg.bufferTime || tmpCfg.periods))
+        {
+            snd_pcm_uframes_t periodSize = tmpCfg.periodSize ? tmpCfg.periodSize : 4096;
+            checkResult(snd_pcm_hw_params_set_period_size_near(_audioHandle, hw_params, &periodSize, 0));
+        }
+
+        if (tmpCfg.periods)
+        {
+            unsigned int periods = tmpCfg.periods;
+            checkResult(snd_pcm_hw_params_set_periods_near(_audioHandle, hw_params, &periods, 0));
+        }
 
         checkResult(snd_pcm_hw_params(_audioHandle, hw_params));
 
+        // Read back what the device agreed to
+        _alsa_to_frames_divisor = tmpCfg.channels;
+        snd_pcm_uframes_t buffer_frames;
+        checkResult(snd_pcm_hw_params_get_period_size(hw_params, &buffer_frames, 0));
+        {
+            unsigned int rate;
+            checkResult(snd_pcm_hw_params_get_rate(hw_params, &rate, 0));
+            tmpCfg.frequency = rate;
+
+            unsigned int periods;
+            checkResult(snd_pcm_hw_params_get_periods(hw_params, &periods, 0));
+            tmpCfg.periods = periods;
+
+            snd_pcm_uframes_t bufferSize;
+            checkResult(snd_pcm_hw_params_get_buffer_size(hw_params, &bufferSize));
+            tmpCfg.bufferTime = (uint_least32_t)(((uint_least64_t)bufferSize * 1000000) / rate);
+        }
+        tmpCfg.periodSize = buffer_frames;
+        tmpCfg.device     = device;
+        tmpCfg.latency    = 0;
+
         snd_pcm_hw_params_free(hw_params);
         hw_params = 0;
 
         checkResult(snd_pcm_prepare(_audioHandle));
         tmpCfg.bufSize = buffer_frames * _alsa_to_frames_divisor;
+        _periodFrames = buffer_frames;
 
         try
         {
@@ -106,6 +157,10 @@ bool Audio_ALSA::open(AudioConfig &cfg)
 
         // Setup internal Config
         _settings = tmpCfg;
+
+        if (_mmap && !mapPeriod())
+            throw error("Unable to map the device buffer.");
+
         // Update the users settings
         getConfig (cfg);
         return true;
@@ -135,6 +190,120 @@ void Audio_ALSA::close()
     }
 }
 
+void Audio_ALSA::getConfig(AudioConfig &cfg) const
+{
+    AudioBase::getConfig(cfg);
+    const snd_pcm_sframes_t delay = _delay;
+    cfg.latency = delay > 0 ? delay : 0;
+    cfg.underruns = _underruns;
+}
+
+// Measure how long it takes for the audio just written to be heard
+void Audio_ALSA::measureDelay()
+{
+    snd_pcm_sframes_t delay;
+    if (snd_pcm_delay(_audioHandle, &delay) >= 0)
+        _delay = delay;
+}
+
+bool Audio_ALSA::recover(int err)
+{
+    if (err == -EPIPE)
+        _underruns++;
+
+    err = snd_pcm_recover(_audioHandle, err, 0);
+    if (err < 0)
+    {
+        setError(snd_strerror(err));
+        return false;
+    }
+    return true;
+}
+
+// Wait for a free period in the device ring and map it. When the
+// period would wrap around the end of the ring it is rendered in
+// the sample buffer instead and copied on write.
+bool Audio_ALSA::mapPeriod()
+{
+    _mmapBuffer = nullptr;
+
+    for (;;)
+    {
+        const snd_pcm_sframes_t avail = snd_pcm_avail_update(_audioHandle);
+        if (avail < 0)
+        {
+            if (!recover(avail))
+                return false;
+            continue;
+        }
+
+        if ((snd_pcm_uframes_t)avail >= _periodFrames)
+            break;
+
+        // Ring is full, playback must be running before we can wait
+        if (snd_pcm_state(_audioHandle) == SND_PCM_STATE_PREPARED)
+        {
+            const int err = snd_pcm_start(_audioHandle);
+            if ((err < 0) && !recover(err))
+                return false;
+        }
+
+        const int err = snd_pcm_wait(_audioHandle, 1000);
+        if ((err < 0) && !recover(err))
+            return false;
+    }
+
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = _periodFrames;
+    const int err = snd_pcm_mmap_begin(_audioHandle, &areas, &offset, &frames);
+    if (err < 0)
+        return recover(err);
+
+    if (frames < _periodFrames)
+    {
+        // Give the area back untouched
+        snd_pcm_mmap_commit(_audioHandle, offset, 0);
+        return true;
+    }
+
+    _mmapOffset = offset;
+    _mmapBuffer = reinterpret_cast<short*>(static_cast<char*>(areas[0].addr)
+        + (areas[0].first + offset * areas[0].step) / 8);
+    return true;
+}
+
+bool Audio_ALSA::writeMmap(snd_pcm_uframes_t frames)
+{
+    if (_mmapBuffer != nullptr)
+    {
+        const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(_audioHandle, _mmapOffset, frames);
+        _mmapBuffer = nullptr;
+        if ((committed < 0) || ((snd_pcm_uframes_t)committed != frames))
+        {
+            if (!recover(committed < 0 ? committed : -EPIPE))
+                return false;
+        }
+    }
+    else
+    {
+        const snd_pcm_sframes_t written = snd_pcm_mmap_writei(_audioHandle, _sampleBuffer, frames);
+        if ((written < 0) && !recover(written))
+            return false;
+    }
+
+    // Start once the ring holds more than a period
+    if ((snd_pcm_state(_audioHandle) == SND_PCM_STATE_PREPARED)
+        && (snd_pcm_avail_update(_audioHandle) < (snd_pcm_sframes_t)_periodFrames))
+    {
+        const int err = snd_pcm_start(_audioHandle);
+        if ((err < 0) && !recover(err))
+            return false;
+    }
+
+    return mapPeriod();
+}
+
 bool Audio_ALSA::write(uint_least32_t size)
 {
     if (_audioHandle == nullptr)
@@ -143,16 +312,18 @@ bool Audio_ALSA::write(uint_least32_t size)
         return false;
     }
 
-    int err = snd_pcm_writei(_audioHandle, _sampleBuffer, size / _alsa_to_frames_divisor);
-    if (err < 0)
+    if (_mmap)
     {
-        err = snd_pcm_recover(_audioHandle, err, 0);
-        if (err < 0)
-        {
-            setError(snd_strerror(err));
+        if (!writeMmap(size / _alsa_to_frames_divisor))
             return false;
-        }
+        measureDelay();
+        return true;
     }
+
+    const int err = snd_pcm_writei(_audioHandle, _sampleBuffer, size / _alsa_to_frames_divisor);
+    if ((err < 0) && !recover(err))
+        return false;
+    measureDelay();
     return true;
 }
 
@@ -34,6 +34,8 @@
 #include <alsa/asoundlib.h>
 #include "../AudioBase.h"
 
+#include <atomic>
+
 
 class Audio_ALSA: public AudioBase
 {
@@ -41,10 +43,25 @@ private:  // ------------------------------------------------------- private
     snd_pcm_t *_audioHandle;
     int _alsa_to_frames_divisor;
 
+    // mmap access
+    bool              _mmap;
+    snd_pcm_uframes_t _periodFrames;
+    snd_pcm_uframes_t _mmapOffset;
+    short            *_mmapBuffer;   // period in the device ring, or null
+
+    // Output delay in frames, measured after each write
+    std::atomic<snd_pcm_sframes_t> _delay;
+    std::atomic<unsigned int> _underruns;
+
 private:
     void outOfOrder();
     static void checkResult(int err);
 
+    bool recover(int err);
+    void measureDelay();
+    bool mapPeriod();
+    bool writeMmap(snd_pcm_uframes_t frames);
+
 public:  // --------------------------------------------------------- public
     Audio_ALSA();
     ~Audio_ALSA();
@@ -54,6 +71,14 @@ public:  // --------------------------------------------------------- public
     void reset () override {}
     bool write (uint_least32_t size) override;
     void pause () override {}
+
+    // With mmap access this is a period of the device ring buffer
+    short *buffer() const override { return _mmapBuffer ? _mmapBuffer : _sampleBuffer; }
+
+    void getConfig(AudioConfig &cfg) const override;
+
+    // true if mmap access was negotiated
+    bool isMmap() const { return _mmap; }
 };
 
 #endif // HAVE_ALSA
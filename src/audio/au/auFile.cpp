@@ -23,150 +23,15 @@
 
 #include "auFile.h"
 
-#include <vector>
-#include <iomanip>
-#include <fstream>
 #include <new>
 
-/// Set the lo byte (8 bit) in a word (16 bit)
-inline void endian_16lo8 (uint_least16_t &word, uint8_t byte)
-{
-    word &= 0xff00;
-    word |= byte;
-}
-
-/// Get the lo byte (8 bit) in a word (16 bit)
-inline uint8_t endian_16lo8 (uint_least16_t word)
-{
-    return (uint8_t) word;
-}
-
-/// Set the hi byte (8 bit) in a word (16 bit)
-inline void endian_16hi8 (uint_least16_t &word, uint8_t byte)
-{
-    word &= 0x00ff;
-    word |= (uint_least16_t) byte << 8;
-}
-
-/// Set the hi byte (8 bit) in a word (16 bit)
-inline uint8_t endian_16hi8 (uint_least16_t word)
-{
-    return (uint8_t) (word >> 8);
-}
-
-/// Swap word endian.
-inline void endian_16swap8 (uint_least16_t &word)
-{
-    uint8_t lo = endian_16lo8 (word);
-    uint8_t hi = endian_16hi8 (word);
-    endian_16lo8 (word, hi);
-    endian_16hi8 (word, lo);
-}
-
-/// Convert high-byte and low-byte to 16-bit word.
-inline uint_least16_t endian_16 (uint8_t hi, uint8_t lo)
-{
-    uint_least16_t word = 0;
-    endian_16lo8 (word, lo);
-    endian_16hi8 (word, hi);
-    return word;
-}
-
-inline void endian_16 (uint8_t ptr[2], uint_least16_t word)
-{
-#if defined(WORDS_BIGENDIAN)
-    ptr[0] = endian_16hi8 (word);
-    ptr[1] = endian_16lo8 (word);
-#else
-    ptr[0] = endian_16lo8 (word);
-    ptr[1] = endian_16hi8 (word);
-#endif
-}
-
-inline void endian_16 (char ptr[2], uint_least16_t word)
-{
-    endian_16 ((uint8_t *) ptr, word);
-}
-
-/// Convert high-byte and low-byte to 16-bit big endian word.
-inline uint_least16_t endian_big16 (const uint8_t ptr[2])
-{
-    return endian_16 (ptr[0], ptr[1]);
-}
-
-/// Write a little-big 16-bit word to two bytes in memory.
-inline void endian_big16 (uint8_t ptr[2], uint_least16_t word)
-{
-    ptr[0] = endian_16hi8 (word);
-    ptr[1] = endian_16lo8 (word);
-}
-
-/// Set the hi word (16bit) in a dword (32 bit)
-inline void endian_32hi16 (uint_least32_t &dword, uint_least16_t word)
-{
-    dword &= (uint_least32_t) 0x0000ffff;
-    dword |= (uint_least32_t) word << 16;
-}
-
-/// Get the hi word (16bit) in a dword (32 bit)
-inline uint_least16_t endian_32hi16 (uint_least32_t dword)
-{
-    return (uint_least16_t) (dword >> 16);
-}
-
-/// Set the lo byte (8 bit) in a dword (32 bit)
-inline void endian_32lo8 (uint_least32_t &dword, uint8_t byte)
-{
-    dword &= (uint_least32_t) 0xffffff00;
-    dword |= (uint_least32_t) byte;
-}
-
-/// Get the lo byte (8 bit) in a dword (32 bit)
-inline uint8_t endian_32lo8 (uint_least32_t dword)
-{
-    return (uint8_t) dword;
-}
-
-/// Set the hi byte (8 bit) in a dword (32 bit)
-inline void endian_32hi8 (uint_least32_t &dword, uint8_t byte)
-{
-    dword &= (uint_least32_t) 0xffff00ff;
-    dword |= (uint_least32_t) byte << 8;
-}
-
-/// Get the hi byte (8 bit) in a dword (32 bit)
-inline uint8_t endian_32hi8 (uint_least32_t dword)
-{
-    return (uint8_t) (dword >> 8);
-}
-
-/// Convert high-byte and low-byte to 32-bit word.
-inline uint_least32_t endian_32 (uint8_t hihi, uint8_t hilo, uint8_t hi, uint8_t lo)
-{
-    uint_least32_t dword = 0;
-    uint_least16_t word  = 0;
-    endian_32lo8  (dword, lo);
-    endian_32hi8  (dword, hi);
-    endian_16lo8  (word,  hilo);
-    endian_16hi8  (word,  hihi);
-    endian_32hi16 (dword, word);
-    return dword;
-}
-
-/// Convert high-byte and low-byte to 32-bit big endian word.
-inline uint_least32_t endian_big32 (const uint8_t ptr[4])
-{
-    return endian_32 (ptr[0], ptr[1], ptr[2], ptr[3]);
-}
-
 // Write a big-endian 32-bit word to four bytes in memory.
 inline void endian_big32 (uint8_t ptr[4], uint_least32_t dword)
 {
-    uint_least16_t word = endian_32hi16 (dword);
-    ptr[0] = endian_16hi8 (word);
-    ptr[1] = endian_16lo8 (word);
-    ptr[2] = endian_32hi8 (dword);
-    ptr[3] = endian_32lo8 (dword);
+    ptr[0] = (uint8_t) (dword >> 24);
+    ptr[1] = (uint8_t) (dword >> 16);
+    ptr[2] = (uint8_t) (dword >> 8);
+    ptr[3] = (uint8_t) dword;
 }
 
 const auHeader auFile::defaultAuHdr =
@@ -184,7 +49,6 @@ auFile::auFile(const std::string &name) :
     AudioBase("AUFILE"),
     name(name),
     auHdr(defaultAuHdr),
-    file(nullptr),
     headerWritten(false),
     precision(32)
 {}
@@ -193,21 +57,24 @@ bool auFile::open(AudioConfig &cfg)
 {
     precision = cfg.precision;
 
-    unsigned short bits       = precision;
-    unsigned long  format     = (precision == 16) ? 3 : 6;
+    const SampleConverter::format_t sampleFormat = (precision == 16) ? SampleConverter::S16_BE
+        : (precision == 24) ? SampleConverter::S24_BE : SampleConverter::F32_BE;
+
+    unsigned long  format     = (precision == 16) ? 3 : (precision == 24) ? 4 : 6;
     unsigned long  channels   = cfg.channels;
     unsigned long  freq       = cfg.frequency;
-    unsigned short blockAlign = (bits>>3)*channels;
-    unsigned long  bufSize    = freq * blockAlign;
+    // One second of samples
+    unsigned long  bufSize    = freq * channels;
     cfg.bufSize = bufSize;
 
     if (name.empty())
         return false;
 
-    if (file && !file->fail())
+    if (file.isOpen())
         close();
 
     byteCount = 0;
+    headerWritten = false;
 
     // We need to make a buffer for the user
     try
@@ -220,18 +87,31 @@ bool auFile::open(AudioConfig &cfg)
         return false;
     }
 
+    if (!converter.setup(sampleFormat, bufSize))
+    {
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
     // Fill in header with parameters and expected file size.
     endian_big32(auHdr.encoding, format);
     endian_big32(auHdr.sampleRate, freq);
     endian_big32(auHdr.channels, channels);
 
-    if (name.compare("-") == 0)
+    if (!file.open(name))
     {
-        file = &std::cout;
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError(file.error());
+        return false;
     }
-    else
+
+    if (cfg.length)
     {
-        file = new std::ofstream(name.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        const uint_least64_t frames = (uint_least64_t)cfg.length * freq / 1000;
+        file.preallocate(sizeof(auHeader) + frames * channels * converter.bytesPerSample());
     }
 
     _settings = cfg;
@@ -240,57 +120,45 @@ bool auFile::open(AudioConfig &cfg)
 
 bool auFile::write(uint_least32_t size)
 {
-    if (file && !file->fail())
+    if (!file.isOpen())
     {
-        unsigned long int bytes = size;
-        if (!headerWritten)
-        {
-            file->write((char*)&auHdr, sizeof(auHeader));
-            headerWritten = true;
-        }
+        setError("File not open.");
+        return false;
+    }
 
-        if (precision == 16)
-        {
-            std::vector<uint_least16_t> buffer(size);
-            bytes *= 2;
-            for (unsigned long i=0; i<size; i++)
-            {
-                uint_least16_t temp = _sampleBuffer[i];
-                buffer[i] = endian_big16((uint8_t*)&temp);
-            }
-            file->write((char*)&buffer.front(), bytes);
-        }
-        else
-        {
-            std::vector<float> buffer(size);
-            bytes *= 4;
-            // normalize floats
-            for (unsigned long i=0; i<size; i++)
-            {
-                float temp = ((float)_sampleBuffer[i])/32768.f;
-                buffer[i] = endian_big32((uint8_t*)&temp);
-            }
-            file->write((char*)&buffer.front(), bytes);
-        }
-        byteCount += bytes;
+    if (!headerWritten)
+    {
+        // On a pipe the size stays unknown, as the format allows
+        if (!file.seekable())
+            endian_big32(auHdr.dataSize, 0xffffffff);
 
+        file.write(&auHdr, sizeof(auHeader));
+        headerWritten = true;
     }
+
+    const unsigned long int bytes = size * converter.bytesPerSample();
+    if (!file.write(converter.convert(_sampleBuffer, size), bytes))
+    {
+        setError(file.error());
+        return false;
+    }
+    byteCount += bytes;
     return true;
 }
 
 void auFile::close()
 {
-    if (file && !file->fail())
+    if (file.isOpen())
     {
         // update length field in header
         endian_big32(auHdr.dataSize, byteCount);
-        if (file != &std::cout)
-        {
-            file->seekp(0, std::ios::beg);
-            file->write((char*)&auHdr, sizeof(auHeader));
-            delete file;
-        }
-        file = nullptr;
+
+        // Patch the header in place once all data is out
+        if (file.flush() && file.seekable())
+            file.pwrite(&auHdr, sizeof(auHeader), 0);
+        if (!file.close())
+            setError(file.error());
         delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
     }
 }
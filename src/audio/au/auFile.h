@@ -28,6 +28,8 @@
 #include <string>
 
 #include "../AudioBase.h"
+#include "../SampleConverter.h"
+#include "../FileWriter.h"
 
 struct auHeader                         // little endian format
 {
@@ -36,7 +38,7 @@ struct auHeader                         // little endian format
     unsigned char dataOffset[4];        // data offset
 
     unsigned char dataSize[4];          // data size
-    unsigned char encoding[4];          // 3 = 16-bit linear PCM, 6 = 32-bit IEEE floating point
+    unsigned char encoding[4];          // 3 = 16-bit, 4 = 24-bit linear PCM, 6 = 32-bit IEEE floating point
 
     unsigned char sampleRate[4];        // sample rate
     unsigned char channels[4];          // 1 = mono, 2 = stereo
@@ -55,17 +57,19 @@ private:
     static const auHeader defaultAuHdr;
     auHeader auHdr;
 
-    std::ostream *file;
+    FileWriter file;
     bool headerWritten;
     int precision;
 
+    SampleConverter converter;
+
 public:
     auFile(const std::string &name);
     ~auFile() { close(); }
 
     static const char *extension () { return ".au"; }
 
-    // Only signed 16-bit and 32bit float samples are supported.
+    // Signed 16-bit, 24-bit and 32bit float samples are supported.
     // Endian-ess is adjusted if necessary.
 
     bool open(AudioConfig &cfg) override;
@@ -78,8 +82,8 @@ public:
     void reset() override {}
 
     // Stream state.
-    bool fail() const { return (file->fail() != 0); }
-    bool bad()  const { return (file->bad()  != 0); }
+    bool fail() const { return file.failed(); }
+    bool bad()  const { return file.failed(); }
 };
 
 #endif /* AU_FILE_H */
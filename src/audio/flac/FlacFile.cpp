@@ -0,0 +1,248 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "FlacFile.h"
+
+#ifdef HAVE_FLAC
+
+#include "../LoudnessMeter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+// Compression level used by the flac tool by default
+const unsigned int COMPRESSION_LEVEL = 5;
+
+FlacFile::FlacFile(const std::string &name) :
+    AudioBase("FLACFILE"),
+    name(name),
+    encoder(nullptr),
+    bits(16),
+    meter(nullptr)
+{
+    metadata[0] = metadata[1] = nullptr;
+}
+
+void FlacFile::setInfo(const char* title, const char* author, const char* released)
+{
+    tags.set(title, author, released);
+}
+
+void FlacFile::freeMetadata()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (metadata[i])
+            FLAC__metadata_object_delete(metadata[i]);
+        metadata[i] = nullptr;
+    }
+}
+
+static bool appendComment(FLAC__StreamMetadata *block, const char *field, const std::string &value)
+{
+    if (value.empty())
+        return true;
+
+    FLAC__StreamMetadata_VorbisComment_Entry entry;
+    return FLAC__metadata_object_vorbiscomment_entry_from_name_value_pair(&entry, field, value.c_str())
+        && FLAC__metadata_object_vorbiscomment_append_comment(block, entry, false);
+}
+
+bool FlacFile::addTags()
+{
+    metadata[0] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT);
+    metadata[1] = FLAC__metadata_object_new(FLAC__METADATA_TYPE_PADDING);
+    if (!metadata[0] || !metadata[1])
+        return false;
+
+    if (tags.valid)
+    {
+        if (!appendComment(metadata[0], "TITLE", tags.title)
+            || !appendComment(metadata[0], "ARTIST", tags.author)
+            || !appendComment(metadata[0], "COPYRIGHT", tags.released))
+            return false;
+    }
+
+    // Room to edit the tags later without rewriting the file
+    metadata[1]->length = 1024;
+
+    return FLAC__stream_encoder_set_metadata(encoder, metadata, 2);
+}
+
+static std::string format(const char *fmt, double value)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), fmt, value);
+    return buf;
+}
+
+// ReplayGain 2.0, relative to -18 LUFS
+bool FlacFile::addLoudnessTags()
+{
+    const LoudnessMeter::result_t &result = meter->result();
+    if (LoudnessMeter::silent(result.integrated))
+        return true;
+
+    FLAC__Metadata_Chain *chain = FLAC__metadata_chain_new();
+    if (!chain)
+    {
+        setError("Unable to allocate memory for the metadata.");
+        return false;
+    }
+
+    bool ok = FLAC__metadata_chain_read(chain, name.c_str());
+    if (ok)
+    {
+        FLAC__Metadata_Iterator *it = FLAC__metadata_iterator_new();
+        ok = (it != nullptr);
+        if (ok)
+        {
+            FLAC__metadata_iterator_init(it, chain);
+            do
+            {
+                FLAC__StreamMetadata *block = FLAC__metadata_iterator_get_block(it);
+                if (block->type == FLAC__METADATA_TYPE_VORBIS_COMMENT)
+                {
+                    ok = appendComment(block, "REPLAYGAIN_TRACK_GAIN", format("%.2f dB", -18. - result.integrated))
+                        && appendComment(block, "REPLAYGAIN_TRACK_PEAK", format("%.6f", std::pow(10., result.truePeak / 20.)))
+                        && appendComment(block, "REPLAYGAIN_REFERENCE_LOUDNESS", "-18.00 LUFS");
+                    break;
+                }
+            } while (FLAC__metadata_iterator_next(it));
+            FLAC__metadata_iterator_delete(it);
+        }
+        // Fits in the padding, the audio is not rewritten
+        ok = ok && FLAC__metadata_chain_write(chain, true, false);
+    }
+
+    if (!ok)
+        setError(FLAC__Metadata_ChainStatusString[FLAC__metadata_chain_status(chain)]);
+    FLAC__metadata_chain_delete(chain);
+    return ok;
+}
+
+bool FlacFile::open(AudioConfig &cfg)
+{
+    if (name.empty())
+        return false;
+
+    if (encoder)
+        close();
+
+    bits = (cfg.precision == 16) ? 16 : 24;
+
+    // One second of samples
+    const uint_least32_t bufSize = cfg.frequency * cfg.channels;
+    cfg.bufSize = bufSize;
+
+    try
+    {
+        _sampleBuffer = new short[bufSize];
+        samples.assign(bufSize, 0);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
+    encoder = FLAC__stream_encoder_new();
+    if (!encoder)
+    {
+        setError("Unable to create the encoder.");
+        close();
+        return false;
+    }
+
+    FLAC__stream_encoder_set_channels(encoder, cfg.channels);
+    FLAC__stream_encoder_set_bits_per_sample(encoder, bits);
+    FLAC__stream_encoder_set_sample_rate(encoder, cfg.frequency);
+    FLAC__stream_encoder_set_compression_level(encoder, COMPRESSION_LEVEL);
+    if (cfg.length)
+        FLAC__stream_encoder_set_total_samples_estimate(encoder, (FLAC__uint64)cfg.length * cfg.frequency / 1000);
+
+    if (!addTags())
+    {
+        setError("Unable to set the metadata.");
+        close();
+        return false;
+    }
+
+    const FLAC__StreamEncoderInitStatus status = (name.compare("-") == 0)
+        ? FLAC__stream_encoder_init_FILE(encoder, stdout, nullptr, nullptr)
+        : FLAC__stream_encoder_init_file(encoder, name.c_str(), nullptr, nullptr);
+    if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
+    {
+        setError(FLAC__StreamEncoderInitStatusString[status]);
+        close();
+        return false;
+    }
+
+    _settings = cfg;
+    return true;
+}
+
+bool FlacFile::write(uint_least32_t size)
+{
+    if (!encoder)
+    {
+        setError("File not open.");
+        return false;
+    }
+
+    const int shift = bits - 16;
+    for (uint_least32_t i = 0; i < size; i++)
+        samples[i] = (FLAC__int32)_sampleBuffer[i] << shift;
+
+    if (!FLAC__stream_encoder_process_interleaved(encoder, &samples[0], size / _settings.channels))
+    {
+        setError(FLAC__stream_encoder_get_resolved_state_string(encoder));
+        return false;
+    }
+    return true;
+}
+
+void FlacFile::close()
+{
+    if (encoder)
+    {
+        // Writes the final STREAMINFO with the real length and checksum
+        const bool ok = FLAC__stream_encoder_finish(encoder);
+        if (!ok)
+            setError(FLAC__stream_encoder_get_resolved_state_string(encoder));
+        FLAC__stream_encoder_delete(encoder);
+        encoder = nullptr;
+
+        if (ok && meter && (name.compare("-") != 0))
+            addLoudnessTags();
+    }
+
+    freeMetadata();
+
+    delete[] _sampleBuffer;
+    _sampleBuffer = nullptr;
+    samples.clear();
+}
+
+#endif // HAVE_FLAC
@@ -0,0 +1,89 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FLAC_FILE_H
+#define FLAC_FILE_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef HAVE_FLAC
+
+#include <string>
+#include <vector>
+
+#include <FLAC/stream_encoder.h>
+#include <FLAC/metadata.h>
+
+#include "../AudioBase.h"
+#include "../TuneTags.h"
+
+class LoudnessMeter;
+
+/*
+ * FLAC file output.
+ *
+ * Encoding is synchronous, wrap it in an Audio_Queue
+ * to move the compression on its own thread.
+ */
+class FlacFile: public AudioBase
+{
+private:
+    std::string name;
+
+    FLAC__StreamEncoder *encoder;
+    FLAC__StreamMetadata *metadata[2];
+    unsigned int bits;
+
+    TuneTags tags;
+    const LoudnessMeter *meter;
+
+    std::vector<FLAC__int32> samples;
+
+private:
+    bool addTags();
+    bool addLoudnessTags();
+    void freeMetadata();
+
+public:
+    FlacFile(const std::string &name);
+    ~FlacFile() { close(); }
+
+    static const char *extension () { return ".flac"; }
+
+    // 16 and 24 bit samples, 32 bit float is written as 24 bit.
+    bool open(AudioConfig &cfg) override;
+
+    bool write(uint_least32_t size) override;
+    void close() override;
+    void pause() override {}
+    void reset() override {}
+
+    // Add Vorbis comments
+    void setInfo(const char* title, const char* author, const char* released);
+
+    // Add ReplayGain comments from the meter on close,
+    // in the padding left for it. Files only.
+    void setLoudness(const LoudnessMeter *meter) { this->meter = meter; }
+};
+
+#endif // HAVE_FLAC
+#endif // FLAC_FILE_H
@@ -0,0 +1,189 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "loudness.h"
+
+#include <fstream>
+#include <iomanip>
+#include <new>
+
+namespace
+{
+
+// Gated out values have no loudness
+void writeValue(std::ostream &out, const char *key, double value)
+{
+    out << "  \"" << key << "\": ";
+    if (LoudnessMeter::silent(value))
+        out << "null";
+    else
+        out << value;
+    out << ",\n";
+}
+
+std::string jsonString(const std::string &str)
+{
+    std::string out("\"");
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+        const unsigned char c = *it;
+        if ((c == '"') || (c == '\\'))
+        {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (c < 0x20)
+        {
+            static const char hex[] = "0123456789abcdef";
+            out.append("\\u00");
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xf]);
+        }
+        else
+        {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+}
+
+Audio_Loudness::Audio_Loudness(IAudio *sink, const std::string &name) :
+    AudioBase("LOUDNESS"),
+    m_sink(sink),
+    m_name(name),
+    m_errorSource(sink),
+    m_open(false) {}
+
+Audio_Loudness::~Audio_Loudness()
+{
+    close();
+    delete m_sink;
+}
+
+std::string Audio_Loudness::reportName(const std::string &name)
+{
+    std::string report(name);
+    const size_t dot = name.find_last_of('.');
+    const size_t slash = name.find_last_of("/\\");
+    if ((dot != std::string::npos) && ((slash == std::string::npos) || (dot > slash)))
+        report.erase(dot);
+    return report.append(".loudness.json");
+}
+
+bool Audio_Loudness::open(AudioConfig &cfg)
+{
+    m_errorSource = m_sink;
+    if (!m_sink->open(cfg))
+        return false;
+
+    if (!m_meter.setup(cfg.frequency, cfg.channels))
+    {
+        m_sink->close();
+        setError("Unsupported number of channels.");
+        m_errorSource = this;
+        return false;
+    }
+
+    _settings = cfg;
+    m_open = true;
+    return true;
+}
+
+bool Audio_Loudness::write(uint_least32_t size)
+{
+    if (!m_open)
+    {
+        setError("Audio device not open.");
+        m_errorSource = this;
+        return false;
+    }
+
+    try
+    {
+        m_meter.process(m_sink->buffer(), size / _settings.channels);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        setError("Unable to allocate memory for the meter.");
+        m_errorSource = this;
+        return false;
+    }
+
+    if (!m_sink->write(size))
+    {
+        m_errorSource = m_sink;
+        return false;
+    }
+    return true;
+}
+
+bool Audio_Loudness::report()
+{
+    const LoudnessMeter::result_t &result = m_meter.result();
+    const std::string name(reportName(m_name));
+
+    std::ofstream out(name.c_str());
+    out << "{\n"
+        << "  \"file\": " << jsonString(m_name) << ",\n"
+        << "  \"sample_rate\": " << _settings.frequency << ",\n"
+        << "  \"channels\": " << _settings.channels << ",\n"
+        << std::fixed << std::setprecision(3)
+        << "  \"duration\": " << (double)result.frames / _settings.frequency << ",\n"
+        << std::setprecision(2);
+    writeValue(out, "integrated_loudness", result.integrated);
+    out << "  \"loudness_range\": " << result.range << ",\n";
+    writeValue(out, "true_peak", result.truePeak);
+    writeValue(out, "sample_peak", result.samplePeak);
+    writeValue(out, "max_momentary_loudness", result.maxMomentary);
+    writeValue(out, "max_short_term_loudness", result.maxShortTerm);
+    out << "  \"clipped_samples\": " << result.clipped << "\n"
+        << "}\n";
+    out.close();
+
+    if (out.fail())
+    {
+        setError(("Cannot write " + name).c_str());
+        return false;
+    }
+    return true;
+}
+
+// The meter is done before the sink is closed so that it can add tags
+void Audio_Loudness::close()
+{
+    if (!m_open)
+        return;
+    m_open = false;
+
+    m_meter.finish();
+
+    m_sink->close();
+    if (*m_sink->getErrorString())
+    {
+        m_errorSource = m_sink;
+        return;
+    }
+
+    if ((m_name.compare("-") != 0) && !report())
+        m_errorSource = this;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef AUDIO_LOUDNESS_H
+#define AUDIO_LOUDNESS_H
+
+#include <string>
+
+#include "../AudioBase.h"
+#include "../LoudnessMeter.h"
+
+/*
+ * Measures what goes to a file as it is written.
+ *
+ * Each block is fed to the meter before it's handed to the
+ * file, so no second pass over the output is needed. On close
+ * the results are written to a JSON file next to the output;
+ * sinks that can store them as tags read them from meter()
+ * when they are closed, which happens after the meter is done.
+ */
+class Audio_Loudness: public AudioBase
+{
+private:  // ------------------------------------------------------- private
+    IAudio * const    m_sink;
+    const std::string m_name;
+    LoudnessMeter     m_meter;
+    const IAudio     *m_errorSource;
+    bool              m_open;
+
+private:
+    bool report();
+
+public:  // --------------------------------------------------------- public
+    // Takes ownership of the sink writing to the named file
+    Audio_Loudness(IAudio *sink, const std::string &name);
+    ~Audio_Loudness();
+
+    const LoudnessMeter &meter() const { return m_meter; }
+
+    // Name of the JSON report of a file
+    static std::string reportName(const std::string &name);
+
+    bool open  (AudioConfig &cfg) override;
+    void close () override;
+    void reset () override { m_sink->reset(); }
+    bool write (uint_least32_t size) override;
+    void pause () override { m_sink->pause(); }
+
+    short *buffer() const override { return m_sink->buffer(); }
+    void getConfig(AudioConfig &cfg) const override { m_sink->getConfig(cfg); }
+
+    const char *getErrorString() const override { return m_errorSource->getErrorString(); }
+};
+
+#endif // AUDIO_LOUDNESS_H
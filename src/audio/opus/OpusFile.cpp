@@ -0,0 +1,150 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "OpusFile.h"
+
+#ifdef HAVE_OPUSENC
+
+#include <cstdio>
+#include <new>
+
+// Longest time audio is held before the page is written, in 48 kHz samples
+const int MUXING_DELAY = 48000 / 4;
+
+static int writeStdout(void *, const unsigned char *ptr, opus_int32 len)
+{
+    return (std::fwrite(ptr, 1, len, stdout) == (size_t)len) ? 0 : 1;
+}
+
+static int closeStdout(void *)
+{
+    return std::fflush(stdout) ? 1 : 0;
+}
+
+OpusFile::OpusFile(const std::string &name) :
+    AudioBase("OPUSFILE"),
+    name(name),
+    encoder(nullptr) {}
+
+void OpusFile::setInfo(const char* title, const char* author, const char* released)
+{
+    tags.set(title, author, released);
+}
+
+bool OpusFile::open(AudioConfig &cfg)
+{
+    if (name.empty())
+        return false;
+
+    if (encoder)
+        close();
+
+    // One second of samples
+    cfg.bufSize = cfg.frequency * cfg.channels;
+
+    try
+    {
+        _sampleBuffer = new short[cfg.bufSize];
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
+    OggOpusComments *comments = ope_comments_create();
+    if (!comments)
+    {
+        setError("Unable to allocate memory for comments.");
+        close();
+        return false;
+    }
+
+    if (tags.valid)
+    {
+        if (!tags.title.empty())
+            ope_comments_add(comments, "TITLE", tags.title.c_str());
+        if (!tags.author.empty())
+            ope_comments_add(comments, "ARTIST", tags.author.c_str());
+        if (!tags.released.empty())
+            ope_comments_add(comments, "COPYRIGHT", tags.released.c_str());
+    }
+
+    // Mapping family 0 covers mono and stereo.
+    // The encoder resamples to 48 kHz if needed.
+    int err = OPE_OK;
+    if (name.compare("-") == 0)
+    {
+        static const OpusEncCallbacks callbacks = { writeStdout, closeStdout };
+        encoder = ope_encoder_create_callbacks(&callbacks, nullptr, comments, cfg.frequency, cfg.channels, 0, &err);
+    }
+    else
+    {
+        encoder = ope_encoder_create_file(name.c_str(), comments, cfg.frequency, cfg.channels, 0, &err);
+    }
+    ope_comments_destroy(comments);
+
+    if (!encoder)
+    {
+        setError(ope_strerror(err));
+        close();
+        return false;
+    }
+
+    ope_encoder_ctl(encoder, OPE_SET_MUXING_DELAY(MUXING_DELAY));
+
+    _settings = cfg;
+    return true;
+}
+
+bool OpusFile::write(uint_least32_t size)
+{
+    if (!encoder)
+    {
+        setError("File not open.");
+        return false;
+    }
+
+    const int err = ope_encoder_write(encoder, _sampleBuffer, size / _settings.channels);
+    if (err != OPE_OK)
+    {
+        setError(ope_strerror(err));
+        return false;
+    }
+    return true;
+}
+
+void OpusFile::close()
+{
+    if (encoder)
+    {
+        // Flush the last pages and the end of stream
+        const int err = ope_encoder_drain(encoder);
+        if (err != OPE_OK)
+            setError(ope_strerror(err));
+        ope_encoder_destroy(encoder);
+        encoder = nullptr;
+    }
+
+    delete[] _sampleBuffer;
+    _sampleBuffer = nullptr;
+}
+
+#endif // HAVE_OPUSENC
@@ -0,0 +1,74 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef OPUS_FILE_H
+#define OPUS_FILE_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef HAVE_OPUSENC
+
+#include <string>
+
+#include <opusenc.h>
+
+#include "../AudioBase.h"
+#include "../TuneTags.h"
+
+/*
+ * Ogg/Opus file output.
+ *
+ * Opus always runs at 48 kHz, other rates are resampled
+ * by libopusenc. Ogg pages are written out as they fill
+ * up so memory use does not grow with the tune length.
+ * Encoding is synchronous, wrap it in an Audio_Queue
+ * to move the compression on its own thread.
+ */
+class OpusFile: public AudioBase
+{
+private:
+    std::string name;
+
+    OggOpusEnc *encoder;
+
+    TuneTags tags;
+
+public:
+    OpusFile(const std::string &name);
+    ~OpusFile() { close(); }
+
+    static const char *extension () { return ".opus"; }
+
+    // Opus is lossy, the precision setting is ignored.
+    bool open(AudioConfig &cfg) override;
+
+    bool write(uint_least32_t size) override;
+    void close() override;
+    void pause() override {}
+    void reset() override {}
+
+    // Add Vorbis comments
+    void setInfo(const char* title, const char* author, const char* released);
+};
+
+#endif // HAVE_OPUSENC
+#endif // OPUS_FILE_H
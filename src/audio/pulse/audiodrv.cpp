@@ -2,6 +2,7 @@
  * This file is part of sidplayfp, a console SID player.
  *
  * Copyright 2013-2016 Leandro Nini
+ * Copyright 2026 red M95
  * Copyright 2008 Antti Lankila
  *
  * This program is free software; you can redistribute it and/or modify
@@ -23,8 +24,8 @@
 
 #ifdef HAVE_PULSE
 
+#include <algorithm>
 #include <new>
-#include <pulse/error.h>
 
 Audio_Pulse::Audio_Pulse() :
     AudioBase("PULSE")
@@ -39,60 +40,239 @@ Audio_Pulse::~Audio_Pulse()
 
 void Audio_Pulse::outOfOrder()
 {
+    _mainloop = nullptr;
+    _context = nullptr;
+    _stream = nullptr;
+    _writeBuffer = nullptr;
     _sampleBuffer = nullptr;
+    _underruns = 0;
     clearError();
 }
 
+void Audio_Pulse::checkResult(int err)
+{
+    if (err < 0)
+    {
+        throw error(pa_strerror(pa_context_errno(_context)));
+    }
+}
+
+// Mainloop callbacks, they only wake up whoever is waiting
+
+void Audio_Pulse::contextState(pa_context *, void *userdata)
+{
+    pa_threaded_mainloop_signal(static_cast<Audio_Pulse*>(userdata)->_mainloop, 0);
+}
+
+void Audio_Pulse::streamState(pa_stream *, void *userdata)
+{
+    pa_threaded_mainloop_signal(static_cast<Audio_Pulse*>(userdata)->_mainloop, 0);
+}
+
+void Audio_Pulse::streamRequest(pa_stream *, size_t, void *userdata)
+{
+    pa_threaded_mainloop_signal(static_cast<Audio_Pulse*>(userdata)->_mainloop, 0);
+}
+
+void Audio_Pulse::streamSuccess(pa_stream *, int, void *userdata)
+{
+    pa_threaded_mainloop_signal(static_cast<Audio_Pulse*>(userdata)->_mainloop, 0);
+}
+
+void Audio_Pulse::streamUnderflow(pa_stream *, void *userdata)
+{
+    static_cast<Audio_Pulse*>(userdata)->_underruns++;
+}
+
+// Wait for the stream to connect, mainloop must be locked
+bool Audio_Pulse::waitReady()
+{
+    for (;;)
+    {
+        const pa_stream_state_t state = pa_stream_get_state(_stream);
+        if (state == PA_STREAM_READY)
+            return true;
+        if (!PA_STREAM_IS_GOOD(state))
+            return false;
+        pa_threaded_mainloop_wait(_mainloop);
+    }
+}
+
+// Wait for an operation to complete, mainloop must be locked
+bool Audio_Pulse::waitOperation(pa_operation *op)
+{
+    if (op == nullptr)
+    {
+        setError(pa_strerror(pa_context_errno(_context)));
+        return false;
+    }
+
+    while (pa_operation_get_state(op) == PA_OPERATION_RUNNING)
+        pa_threaded_mainloop_wait(_mainloop);
+    pa_operation_unref(op);
+    return true;
+}
+
+// Get server memory for the next period. If the server can't
+// give a whole period at once the sample buffer is used and
+// copied on write. Mainloop must be locked.
+bool Audio_Pulse::beginWrite()
+{
+    const size_t wanted = _settings.bufSize * sizeof(short);
+    size_t nbytes = wanted;
+    void *data;
+
+    _writeBuffer = nullptr;
+
+    if (pa_stream_begin_write(_stream, &data, &nbytes) < 0)
+    {
+        setError(pa_strerror(pa_context_errno(_context)));
+        return false;
+    }
+
+    if (nbytes < wanted)
+        pa_stream_cancel_write(_stream);
+    else
+        _writeBuffer = data;
+    return true;
+}
+
 bool Audio_Pulse::open(AudioConfig &cfg)
 {
-    pa_sample_spec pacfg = {};
-
-    pacfg.channels = cfg.channels;
-    pacfg.rate = cfg.frequency;
-    pacfg.format = PA_SAMPLE_S16NE;
-
-    // Set sample precision and type of encoding.
-    int err;
-    _audioHandle = pa_simple_new(
-        nullptr,
-        "sidplayfp",
-        PA_STREAM_PLAYBACK,
-        nullptr,
-        "sidplayfp",
-        &pacfg,
-        nullptr,
-        nullptr,
-        &err
-    );
+    bool locked = false;
 
     try
     {
-        if (! _audioHandle) {
-            throw error(pa_strerror(err));
+        if (_mainloop != nullptr)
+        {
+            throw error("Device already in use");
+        }
+
+        // May later be replaced with server values.
+        AudioConfig tmpCfg = cfg;
+
+        _mainloop = pa_threaded_mainloop_new();
+        if (_mainloop == nullptr)
+        {
+            throw error("Unable to create the mainloop.");
+        }
+
+        _context = pa_context_new(pa_threaded_mainloop_get_api(_mainloop), "sidplayfp");
+        if (_context == nullptr)
+        {
+            throw error("Unable to create the context.");
         }
+        pa_context_set_state_callback(_context, contextState, this);
 
-        cfg.bufSize = 4096;
+        checkResult(pa_context_connect(_context, nullptr, PA_CONTEXT_NOFLAGS, nullptr));
+
+        pa_threaded_mainloop_lock(_mainloop);
+        locked = true;
+
+        if (pa_threaded_mainloop_start(_mainloop) < 0)
+        {
+            throw error("Unable to start the mainloop.");
+        }
+
+        for (;;)
+        {
+            const pa_context_state_t state = pa_context_get_state(_context);
+            if (state == PA_CONTEXT_READY)
+                break;
+            if (!PA_CONTEXT_IS_GOOD(state))
+                throw error(pa_strerror(pa_context_errno(_context)));
+            pa_threaded_mainloop_wait(_mainloop);
+        }
+
+        pa_sample_spec spec = {};
+        spec.format = PA_SAMPLE_S16NE;
+        spec.rate = tmpCfg.frequency;
+        spec.channels = tmpCfg.channels;
+        _frameSize = pa_frame_size(&spec);
+
+        _stream = pa_stream_new(_context, "sidplayfp", &spec, nullptr);
+        if (_stream == nullptr)
+        {
+            throw error(pa_strerror(pa_context_errno(_context)));
+        }
+        pa_stream_set_state_callback(_stream, streamState, this);
+        pa_stream_set_write_callback(_stream, streamRequest, this);
+        pa_stream_set_underflow_callback(_stream, streamUnderflow, this);
+
+        // Request size from the period, target length from the
+        // buffer time or the number of periods, server defaults
+        // for everything else. Without settings the period keeps
+        // the old 4096 samples buffer.
+        const uint32_t period = tmpCfg.periodSize ? tmpCfg.periodSize : 4096 / tmpCfg.channels;
+
+        pa_buffer_attr attr;
+        attr.maxlength = (uint32_t) -1;
+        attr.prebuf    = (uint32_t) -1;
+        attr.fragsize  = (uint32_t) -1;
+        attr.minreq    = period * _frameSize;
+        if (tmpCfg.bufferTime)
+            attr.tlength = pa_usec_to_bytes(tmpCfg.bufferTime, &spec);
+        else if (tmpCfg.periods)
+            attr.tlength = tmpCfg.periods * attr.minreq;
+        else
+            attr.tlength = (uint32_t) -1;
+
+        const pa_stream_flags_t flags = static_cast<pa_stream_flags_t>(
+            PA_STREAM_ADJUST_LATENCY | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_INTERPOLATE_TIMING);
+
+        const char *device = tmpCfg.device.empty() ? nullptr : tmpCfg.device.c_str();
+        checkResult(pa_stream_connect_playback(_stream, device, &attr, flags, nullptr, nullptr));
+
+        if (!waitReady())
+        {
+            throw error(pa_strerror(pa_context_errno(_context)));
+        }
+
+        // Read back what the server agreed to
+        {
+            const pa_buffer_attr *actual = pa_stream_get_buffer_attr(_stream);
+            const uint32_t minreq = actual->minreq ? actual->minreq : attr.minreq;
+            tmpCfg.periodSize = minreq / _frameSize;
+            tmpCfg.periods    = std::max<uint32_t>(actual->tlength / minreq, 1);
+            tmpCfg.bufferTime = (uint_least32_t) pa_bytes_to_usec(actual->tlength, &spec);
+
+            const char *name = pa_stream_get_device_name(_stream);
+            tmpCfg.device = name ? name : "";
+        }
+        tmpCfg.bufSize = tmpCfg.periodSize * tmpCfg.channels;
+        tmpCfg.latency = 0;
+        tmpCfg.underruns = 0;
 
         try
         {
-            _sampleBuffer = new short[cfg.bufSize];
+            _sampleBuffer = new short[tmpCfg.bufSize];
         }
         catch (std::bad_alloc const &ba)
         {
             throw error("Unable to allocate memory for sample buffers.");
         }
 
-        _settings = cfg;
+        // Setup internal Config
+        _settings = tmpCfg;
+
+        if (!beginWrite())
+        {
+            throw error("Unable to get a write buffer.");
+        }
+
+        pa_threaded_mainloop_unlock(_mainloop);
 
+        // Update the users settings
+        AudioBase::getConfig(cfg);
         return true;
     }
-    catch(error const  &e)
+    catch(error const &e)
     {
-        setError(e.message());
+        if (locked)
+            pa_threaded_mainloop_unlock(_mainloop);
+        close();
 
-        if (_audioHandle)
-            pa_simple_free(_audioHandle);
-        _audioHandle = nullptr;
+        setError(e.message());
 
         return false;
     }
@@ -102,34 +282,114 @@ bool Audio_Pulse::open(AudioConfig &cfg)
 // reset any variables that reflect the current state.
 void Audio_Pulse::close()
 {
-    if (_audioHandle != nullptr)
+    if (_mainloop != nullptr)
     {
-        pa_simple_free(_audioHandle);
-        _audioHandle = nullptr;
-    }
+        pa_threaded_mainloop_lock(_mainloop);
+        if (_stream != nullptr)
+        {
+            if (_writeBuffer != nullptr)
+                pa_stream_cancel_write(_stream);
+            pa_stream_disconnect(_stream);
+            pa_stream_unref(_stream);
+        }
+        if (_context != nullptr)
+        {
+            pa_context_disconnect(_context);
+            pa_context_unref(_context);
+        }
+        pa_threaded_mainloop_unlock(_mainloop);
+
+        pa_threaded_mainloop_stop(_mainloop);
+        pa_threaded_mainloop_free(_mainloop);
 
-    if (_sampleBuffer != nullptr)
-    {
         delete [] _sampleBuffer;
         outOfOrder ();
     }
 }
 
+// Stop playback, resumed by the next write
+void Audio_Pulse::pause()
+{
+    if (_stream == nullptr)
+        return;
+
+    pa_threaded_mainloop_lock(_mainloop);
+    waitOperation(pa_stream_cork(_stream, 1, streamSuccess, this));
+    pa_threaded_mainloop_unlock(_mainloop);
+}
+
+// Drop audio queued in the server
+void Audio_Pulse::reset()
+{
+    if (_stream == nullptr)
+        return;
+
+    pa_threaded_mainloop_lock(_mainloop);
+    waitOperation(pa_stream_flush(_stream, streamSuccess, this));
+    pa_threaded_mainloop_unlock(_mainloop);
+}
+
 bool Audio_Pulse::write(uint_least32_t size)
 {
-    if (_audioHandle == nullptr)
+    if (_stream == nullptr)
     {
         setError("Device not open.");
         return false;
     }
 
-    int err;
-    if (pa_simple_write(_audioHandle, _sampleBuffer, size * 2, &err) < 0)
+    const size_t bytes = size * sizeof(short);
+
+    pa_threaded_mainloop_lock(_mainloop);
+
+    if (pa_stream_is_corked(_stream) > 0)
     {
-        setError(pa_strerror(err));
-        // FIXME should we return false here?
+        pa_operation *op = pa_stream_cork(_stream, 0, nullptr, nullptr);
+        if (op != nullptr)
+            pa_operation_unref(op);
     }
-    return true;
+
+    // Wait for room in the server buffer
+    const size_t needed = std::min(bytes, (size_t) pa_stream_get_buffer_attr(_stream)->tlength);
+    while (pa_stream_writable_size(_stream) < needed)
+    {
+        if (!PA_STREAM_IS_GOOD(pa_stream_get_state(_stream)))
+        {
+            setError(pa_strerror(pa_context_errno(_context)));
+            pa_threaded_mainloop_unlock(_mainloop);
+            return false;
+        }
+        pa_threaded_mainloop_wait(_mainloop);
+    }
+
+    // Memory from pa_stream_begin_write is passed on, not copied
+    const void *data = _writeBuffer ? _writeBuffer : _sampleBuffer;
+    _writeBuffer = nullptr;
+    if (pa_stream_write(_stream, data, bytes, nullptr, 0, PA_SEEK_RELATIVE) < 0)
+    {
+        setError(pa_strerror(pa_context_errno(_context)));
+        pa_threaded_mainloop_unlock(_mainloop);
+        return false;
+    }
+
+    const bool ok = beginWrite();
+    pa_threaded_mainloop_unlock(_mainloop);
+    return ok;
+}
+
+void Audio_Pulse::getConfig(AudioConfig &cfg) const
+{
+    AudioBase::getConfig(cfg);
+
+    if (_stream == nullptr)
+        return;
+
+    pa_threaded_mainloop_lock(_mainloop);
+    pa_usec_t usec;
+    int negative;
+    if ((pa_stream_get_latency(_stream, &usec, &negative) == 0) && !negative)
+        cfg.latency = (uint_least32_t) ((usec * cfg.frequency) / 1000000);
+    cfg.underruns = _underruns;
+    pa_threaded_mainloop_unlock(_mainloop);
 }
 
 #endif // HAVE_PULSE
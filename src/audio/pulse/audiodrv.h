@@ -31,15 +31,40 @@
 #  define AudioDriver Audio_Pulse
 #endif
 
-#include <pulse/simple.h>
+#include <pulse/pulseaudio.h>
 
 #include "../AudioBase.h"
 
+/*
+ * Asynchronous PulseAudio stream driven by a threaded mainloop.
+ *
+ * Each period is rendered straight into memory obtained from
+ * pa_stream_begin_write and handed over without copying.
+ */
 class Audio_Pulse: public AudioBase
 {
 private:  // ------------------------------------------------------- private
-    pa_simple *_audioHandle;
+    pa_threaded_mainloop *_mainloop;
+    pa_context *_context;
+    pa_stream *_stream;
+
+    void *_writeBuffer;   // from pa_stream_begin_write, or null
+    size_t _frameSize;
+    unsigned int _underruns;
+
+private:
     void outOfOrder ();
+    void checkResult(int err);
+
+    bool waitReady();
+    bool waitOperation(pa_operation *op);
+    bool beginWrite();
+
+    static void contextState(pa_context *c, void *userdata);
+    static void streamState(pa_stream *s, void *userdata);
+    static void streamRequest(pa_stream *s, size_t nbytes, void *userdata);
+    static void streamUnderflow(pa_stream *s, void *userdata);
+    static void streamSuccess(pa_stream *s, int success, void *userdata);
 
 public:  // --------------------------------------------------------- public
     Audio_Pulse();
@@ -47,9 +72,13 @@ public:  // --------------------------------------------------------- public
 
     bool open  (AudioConfig &cfg) override;
     void close () override;
-    void reset () override {}
+    void reset () override;
     bool write (uint_least32_t size) override;
-    void pause () override {}
+    void pause () override;
+
+    short *buffer() const override { return _writeBuffer ? static_cast<short*>(_writeBuffer) : _sampleBuffer; }
+
+    void getConfig(AudioConfig &cfg) const override;
 };
 
 #endif // HAVE_PULSE
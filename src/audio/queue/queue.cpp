@@ -0,0 +1,223 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "queue.h"
+
+#include <new>
+#include <cstring>
+
+Audio_Queue::Audio_Queue(IAudio *device, unsigned int depth, bool keep) :
+    AudioBase("QUEUE"),
+    m_device(device),
+    m_depth(depth ? depth : 1),
+    m_keep(keep),
+    m_head(0),
+    m_tail(0),
+    m_command(CMD_NONE),
+    m_quit(false),
+    m_failed(false),
+    m_waiting(0),
+    m_minFill(0),
+    m_empty(0) {}
+
+Audio_Queue::~Audio_Queue()
+{
+    close();
+    delete m_device;
+}
+
+bool Audio_Queue::open(AudioConfig &cfg)
+{
+    if (m_thread.joinable())
+    {
+        setError("Audio device already open.");
+        return false;
+    }
+
+    clearError();
+    if (!m_device->open(cfg))
+        return false;
+
+    _settings = cfg;
+
+    try
+    {
+        m_blocks.assign(m_depth * cfg.bufSize, 0);
+        m_sizes.assign(m_depth, 0);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        m_device->close();
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
+    m_head    = 0;
+    m_tail    = 0;
+    m_command = CMD_NONE;
+    m_quit    = false;
+    m_failed  = false;
+    m_minFill = m_depth;
+    m_empty   = 0;
+
+    m_thread = std::thread(&Audio_Queue::output, this);
+    return true;
+}
+
+// Play what's left and stop the output thread
+void Audio_Queue::close()
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_quit = true;
+    notify();
+    m_thread.join();
+
+    m_device->close();
+    m_blocks.clear();
+    m_sizes.clear();
+}
+
+short *Audio_Queue::buffer() const
+{
+    return m_blocks.empty() ? nullptr : const_cast<short*>(&m_blocks[(m_head % m_depth) * _settings.bufSize]);
+}
+
+void Audio_Queue::getConfig(AudioConfig &cfg) const
+{
+    m_device->getConfig(cfg);
+
+    // Queued blocks add to the delay measured by the device
+    if (cfg.latency)
+        cfg.latency += (m_head - m_tail) * _settings.bufSize / _settings.channels;
+}
+
+// Wake up the other side if it's asleep. The index or flag
+// it waits for is stored before m_waiting is read (all seq_cst),
+// and the sleeper counts itself before checking, so either it sees
+// the change or we see it; taking the lock then makes sure
+// it's already waiting and the wakeup cannot get lost
+void Audio_Queue::notify()
+{
+    if (m_waiting == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+    }
+    m_wakeup.notify_all();
+}
+
+// Sleep until ready() holds
+template<class Predicate>
+void Audio_Queue::wait(Predicate ready)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_waiting++;
+    m_wakeup.wait(lock, ready);
+    m_waiting--;
+}
+
+// Run a command on the output thread and wait for it
+void Audio_Queue::command(command_t cmd)
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_command = cmd;
+    notify();
+
+    wait([this] { return m_command == CMD_NONE; });
+}
+
+bool Audio_Queue::write(uint_least32_t size)
+{
+    if (!m_thread.joinable())
+    {
+        setError("Audio device not open.");
+        return false;
+    }
+
+    const unsigned int head = m_head;
+    m_sizes[head % m_depth] = size;
+    m_head = head + 1;
+    notify();
+
+    // Wait for a free block for the next buffer
+    if (m_head - m_tail >= m_depth)
+    {
+        wait([this] {
+            return (m_head - m_tail < m_depth) || m_failed;
+        });
+    }
+
+    return !m_failed;
+}
+
+void Audio_Queue::output()
+{
+    bool started = false;
+
+    for (;;)
+    {
+        if (started && (m_head == m_tail) && !m_quit && (m_command == CMD_NONE))
+            m_empty++;
+        wait([this] {
+            return (m_head != m_tail) || m_quit || (m_command != CMD_NONE);
+        });
+
+        const int cmd = m_command;
+        if (cmd != CMD_NONE)
+        {
+            // Drop what's queued
+            if (!m_keep)
+                m_tail = m_head.load();
+            if (cmd == CMD_PAUSE)
+                m_device->pause();
+            else
+                m_device->reset();
+            started   = false;
+            m_command = CMD_NONE;
+            notify();
+            continue;
+        }
+
+        const unsigned int tail = m_tail;
+        const unsigned int fill = m_head - tail;
+        if (fill == 0)
+        {
+            if (m_quit)
+                break;
+            continue;
+        }
+
+        if (started && (fill - 1 < m_minFill))
+            m_minFill = fill - 1;
+        started = true;
+
+        const uint_least32_t size = m_sizes[tail % m_depth];
+        memcpy(m_device->buffer(), &m_blocks[(tail % m_depth) * _settings.bufSize], size * sizeof(short));
+        if (!m_device->write(size))
+            m_failed = true;
+
+        m_tail = tail + 1;
+        notify();
+    }
+}
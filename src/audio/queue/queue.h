@@ -0,0 +1,108 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef AUDIO_QUEUE_H
+#define AUDIO_QUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "../AudioBase.h"
+
+/*
+ * Decouples the emulation from a blocking audio driver.
+ *
+ * The player renders into a ring of sample blocks and a
+ * dedicated thread drains it into the real driver, so a slow
+ * write, a display refresh or a keypress no longer stall the
+ * emulation. The ring is single producer/single consumer:
+ * blocks are handed over with atomic indices only, the mutex
+ * is used just to sleep when the ring is full or empty and
+ * is taken by the other side only when someone is asleep.
+ * All the driver calls but open are done by the output thread.
+ */
+class Audio_Queue: public AudioBase
+{
+private:  // ------------------------------------------------------- private
+    enum command_t { CMD_NONE, CMD_PAUSE, CMD_RESET };
+
+    IAudio * const     m_device;
+    const unsigned int m_depth;
+    const bool         m_keep;
+
+    std::vector<short>          m_blocks;
+    std::vector<uint_least32_t> m_sizes;
+
+    std::atomic<unsigned int> m_head; // blocks written by the player
+    std::atomic<unsigned int> m_tail; // blocks played
+    std::atomic<int>          m_command;
+    std::atomic<bool>         m_quit;
+    std::atomic<bool>         m_failed;
+    std::atomic<unsigned int> m_waiting; // threads asleep on m_wakeup
+
+    std::mutex              m_lock;
+    std::condition_variable m_wakeup;
+    std::thread             m_thread;
+
+    // Statistics
+    std::atomic<unsigned int> m_minFill;
+    std::atomic<unsigned int> m_empty;
+
+private:
+    void notify();
+    template<class Predicate>
+    void wait(Predicate ready);
+    void command(command_t cmd);
+    void output();
+
+public:  // --------------------------------------------------------- public
+    // Depth used to run a file encoder in the background
+    static const unsigned int ENCODER_DEPTH = 4;
+
+public:
+    // Takes ownership of the device. With keep set
+    // pause and reset do not drop the queued blocks,
+    // as needed by file output
+    Audio_Queue(IAudio *device, unsigned int depth, bool keep = false);
+    ~Audio_Queue();
+
+    bool open  (AudioConfig &cfg) override;
+    void close () override;
+    void reset () override { command(CMD_RESET); }
+    bool write (uint_least32_t size) override;
+    void pause () override { command(CMD_PAUSE); }
+
+    short *buffer() const override;
+    void getConfig(AudioConfig &cfg) const override;
+
+    const char *getErrorString() const override
+    {
+        const char *error = AudioBase::getErrorString();
+        return *error ? error : m_device->getErrorString();
+    }
+
+    unsigned int depth() const { return m_depth; }
+    unsigned int minFill() const { return m_minFill; }
+    unsigned int emptyCount() const { return m_empty; }
+};
+
+#endif // AUDIO_QUEUE_H
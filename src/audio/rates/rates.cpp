@@ -0,0 +1,186 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "rates.h"
+
+#include <memory>
+#include <new>
+#include <sstream>
+
+Audio_Rates::Audio_Rates(IAudio *main) :
+    AudioBase("RATES"),
+    m_main(main),
+    m_errorSource(main),
+    m_open(false) {}
+
+Audio_Rates::~Audio_Rates()
+{
+    close();
+    for (std::vector<output_t>::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it)
+        delete it->sink;
+    delete m_main;
+}
+
+void Audio_Rates::add(IAudio *sink, unsigned int frequency)
+{
+    std::unique_ptr<IAudio> guard(sink);
+    m_outputs.push_back(output_t());
+    m_outputs.back().sink      = sink;
+    m_outputs.back().frequency = frequency;
+    m_outputs.back().bufFrames = 0;
+    guard.release();
+}
+
+bool Audio_Rates::open(AudioConfig &cfg)
+{
+    if (m_open)
+    {
+        setError("Audio device already open.");
+        m_errorSource = this;
+        return false;
+    }
+
+    m_errorSource = m_main;
+    if (!m_main->open(cfg))
+        return false;
+
+    _settings = cfg;
+
+    for (size_t i = 0; i < m_outputs.size(); i++)
+    {
+        output_t &output = m_outputs[i];
+
+        AudioConfig outputCfg = cfg;
+        outputCfg.frequency = output.frequency;
+        outputCfg.bufSize   = 0;
+
+        bool ok = output.sink->open(outputCfg);
+        if (!ok)
+        {
+            m_errorSource = output.sink;
+        }
+        else if (!output.resampler.setup(cfg.frequency, outputCfg.frequency, cfg.channels))
+        {
+            std::ostringstream sstream;
+            sstream << "cannot resample from " << cfg.frequency << " to " << outputCfg.frequency << " Hz";
+            setError(sstream.str().c_str());
+            m_errorSource = this;
+            output.sink->close();
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            while (i--)
+                m_outputs[i].sink->close();
+            m_main->close();
+            return false;
+        }
+        output.bufFrames = outputCfg.bufSize / cfg.channels;
+    }
+
+    m_open = true;
+    return true;
+}
+
+bool Audio_Rates::drain(output_t &output)
+{
+    const unsigned int channels = _settings.channels;
+
+    size_t frames;
+    while ((frames = output.resampler.pull(output.sink->buffer(), output.bufFrames)) > 0)
+    {
+        if (!output.sink->write(frames * channels))
+        {
+            m_errorSource = output.sink;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Audio_Rates::write(uint_least32_t size)
+{
+    if (!m_open)
+    {
+        setError("Audio device not open.");
+        m_errorSource = this;
+        return false;
+    }
+
+    // The main buffer may be swapped once written
+    const short *samples = m_main->buffer();
+    for (std::vector<output_t>::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it)
+    {
+        try
+        {
+            it->resampler.push(samples, size / _settings.channels);
+        }
+        catch (std::bad_alloc const &ba)
+        {
+            setError("Unable to allocate memory for sample buffers.");
+            m_errorSource = this;
+            return false;
+        }
+        if (!drain(*it))
+            return false;
+    }
+
+    if (!m_main->write(size))
+    {
+        m_errorSource = m_main;
+        return false;
+    }
+    return true;
+}
+
+// Flush the filters and close everything
+void Audio_Rates::close()
+{
+    if (!m_open)
+        return;
+    m_open = false;
+
+    bool failed = false;
+    for (std::vector<output_t>::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it)
+    {
+        it->resampler.finish();
+        if (!drain(*it))
+            failed = true;
+        it->sink->close();
+        // Closing a file may still fail, e.g. while flushing
+        if (!failed && *it->sink->getErrorString())
+        {
+            m_errorSource = it->sink;
+            failed = true;
+        }
+    }
+
+    m_main->close();
+    if (!failed && *m_main->getErrorString())
+        m_errorSource = m_main;
+}
+
+void Audio_Rates::reset()
+{
+    m_main->reset();
+    for (std::vector<output_t>::iterator it = m_outputs.begin(); it != m_outputs.end(); ++it)
+        it->sink->reset();
+}
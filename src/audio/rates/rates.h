@@ -0,0 +1,76 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef AUDIO_RATES_H
+#define AUDIO_RATES_H
+
+#include <vector>
+
+#include "../AudioBase.h"
+#include "../Resampler.h"
+
+/*
+ * Writes the same render to files at several sample rates.
+ *
+ * The engine runs once at the rate of the main sink and renders
+ * straight into its buffer; before each block is handed over it
+ * is resampled into every other sink. Encoders already run on
+ * their own queue thread so resampling is all that's left here.
+ */
+class Audio_Rates: public AudioBase
+{
+private:  // ------------------------------------------------------- private
+    struct output_t
+    {
+        IAudio        *sink;
+        unsigned int   frequency;
+        uint_least32_t bufFrames;
+        Resampler      resampler;
+    };
+
+    IAudio * const        m_main;
+    std::vector<output_t> m_outputs;
+    const IAudio         *m_errorSource;
+    bool                  m_open;
+
+private:
+    bool drain(output_t &output);
+
+public:  // --------------------------------------------------------- public
+    // Takes ownership of the main sink
+    Audio_Rates(IAudio *main);
+    ~Audio_Rates();
+
+    // Takes ownership of the sink, call before open
+    void add(IAudio *sink, unsigned int frequency);
+
+    bool open  (AudioConfig &cfg) override;
+    void close () override;
+    void reset () override;
+    bool write (uint_least32_t size) override;
+    void pause () override { m_main->pause(); }
+
+    short *buffer() const override { return m_main->buffer(); }
+    void getConfig(AudioConfig &cfg) const override { m_main->getConfig(cfg); }
+
+    const char *getErrorString() const override { return m_errorSource->getErrorString(); }
+};
+
+#endif // AUDIO_RATES_H
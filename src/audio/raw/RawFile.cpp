@@ -0,0 +1,106 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "RawFile.h"
+
+#include <new>
+
+RawFile::RawFile(const std::string &name) :
+    AudioBase("RAWFILE"),
+    name(name)
+{}
+
+bool RawFile::open(AudioConfig &cfg)
+{
+    const SampleConverter::format_t sampleFormat = (cfg.precision == 16) ? SampleConverter::S16_LE
+        : (cfg.precision == 24) ? SampleConverter::S24_LE : SampleConverter::F32_LE;
+
+    // One second of samples
+    const unsigned long bufSize = cfg.frequency * cfg.channels;
+    cfg.bufSize = bufSize;
+
+    if (name.empty())
+        return false;
+
+    if (file.isOpen())
+        close();
+
+    try
+    {
+        _sampleBuffer = new short[bufSize];
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
+    if (!converter.setup(sampleFormat, bufSize))
+    {
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
+    if (!file.open(name))
+    {
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError(file.error());
+        return false;
+    }
+
+    if (cfg.length)
+    {
+        const uint_least64_t frames = (uint_least64_t)cfg.length * cfg.frequency / 1000;
+        file.preallocate(frames * cfg.channels * converter.bytesPerSample());
+    }
+
+    _settings = cfg;
+    return true;
+}
+
+bool RawFile::write(uint_least32_t size)
+{
+    if (!file.isOpen())
+    {
+        setError("File not open.");
+        return false;
+    }
+
+    if (!file.write(converter.convert(_sampleBuffer, size), size * converter.bytesPerSample()))
+    {
+        setError(file.error());
+        return false;
+    }
+    return true;
+}
+
+void RawFile::close()
+{
+    if (file.isOpen())
+    {
+        if (!file.close())
+            setError(file.error());
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef RAW_FILE_H
+#define RAW_FILE_H
+
+#include <string>
+
+#include "../AudioBase.h"
+#include "../SampleConverter.h"
+#include "../FileWriter.h"
+
+/*
+ * Headerless PCM output, little endian.
+ *
+ * Meant for streaming into other programs: written to
+ * standard output the pages are passed to a pipe without
+ * copies where the system allows it.
+ */
+class RawFile: public AudioBase
+{
+private:
+    std::string name;
+
+    FileWriter file;
+
+    SampleConverter converter;
+
+public:
+    RawFile(const std::string &name);
+    ~RawFile() { close(); }
+
+    static const char *extension () { return ".raw"; }
+
+    // Signed 16-bit, 24-bit and 32bit float samples are supported.
+    bool open(AudioConfig &cfg) override;
+
+    bool write(uint_least32_t size) override;
+    void close() override;
+    void pause() override {}
+    void reset() override {}
+};
+
+#endif /* RAW_FILE_H */
@@ -0,0 +1,224 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "tee.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <cstring>
+
+// Time the ring can hold, in seconds
+const unsigned int RING_TIME = 8;
+
+Audio_Tee::Audio_Tee(IAudio *device) :
+    AudioBase("TEE"),
+    m_device(device),
+    m_errorSource(device),
+    m_depth(0),
+    m_head(0),
+    m_tail(0),
+    m_quit(false),
+    m_failed(false),
+    m_dropped(0) {}
+
+Audio_Tee::~Audio_Tee()
+{
+    close();
+    for (std::vector<IAudio*>::iterator it = m_recorders.begin(); it != m_recorders.end(); ++it)
+        delete *it;
+    delete m_device;
+}
+
+void Audio_Tee::add(IAudio *recorder)
+{
+    std::unique_ptr<IAudio> guard(recorder);
+    m_recorders.push_back(recorder);
+    guard.release();
+}
+
+void Audio_Tee::fail(const IAudio *recorder)
+{
+    if (!m_failed)
+        m_errorSource = recorder;
+    m_failed = true;
+}
+
+bool Audio_Tee::open(AudioConfig &cfg)
+{
+    if (m_thread.joinable())
+    {
+        setError("Audio device already open.");
+        m_errorSource = this;
+        return false;
+    }
+
+    m_errorSource = m_device;
+    if (!m_device->open(cfg))
+        return false;
+
+    _settings = cfg;
+
+    // Recorders take what the device negotiated
+    m_recorderBufSize.assign(m_recorders.size(), 0);
+    for (size_t i = 0; i < m_recorders.size(); i++)
+    {
+        AudioConfig recorderCfg = cfg;
+        recorderCfg.bufSize = 0;
+        if (!m_recorders[i]->open(recorderCfg))
+        {
+            m_errorSource = m_recorders[i];
+            while (i--)
+                m_recorders[i]->close();
+            m_device->close();
+            return false;
+        }
+        m_recorderBufSize[i] = recorderCfg.bufSize - (recorderCfg.bufSize % cfg.channels);
+    }
+
+    m_depth = std::max(4u, (unsigned int)((uint_least64_t)RING_TIME * cfg.frequency * cfg.channels / cfg.bufSize));
+
+    try
+    {
+        m_blocks.assign(m_depth * cfg.bufSize, 0);
+        m_sizes.assign(m_depth, 0);
+    }
+    catch (std::bad_alloc const &ba)
+    {
+        for (std::vector<IAudio*>::iterator it = m_recorders.begin(); it != m_recorders.end(); ++it)
+            (*it)->close();
+        m_device->close();
+        setError("Unable to allocate memory for sample buffers.");
+        m_errorSource = this;
+        return false;
+    }
+
+    m_head   = 0;
+    m_tail   = 0;
+    m_quit   = false;
+    m_failed  = false;
+    m_dropped = 0;
+
+    m_thread = std::thread(&Audio_Tee::record, this);
+    return true;
+}
+
+// Record what's left and close everything
+void Audio_Tee::close()
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_quit = true;
+    notify();
+    m_thread.join();
+
+    // Closing a file may still fail, e.g. while flushing
+    for (std::vector<IAudio*>::iterator it = m_recorders.begin(); it != m_recorders.end(); ++it)
+    {
+        (*it)->close();
+        if (*(*it)->getErrorString())
+            fail(*it);
+    }
+
+    m_device->close();
+    m_blocks.clear();
+    m_sizes.clear();
+}
+
+// Wake up the other side, taking the lock
+// so that the wakeup cannot get lost
+void Audio_Tee::notify()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+    }
+    m_wakeup.notify_all();
+}
+
+bool Audio_Tee::write(uint_least32_t size)
+{
+    if (!m_thread.joinable())
+    {
+        setError("Audio device not open.");
+        m_errorSource = this;
+        return false;
+    }
+
+    // Recorders way behind, the device must not wait for them
+    if (m_head - m_tail.load(std::memory_order_acquire) >= m_depth)
+    {
+        m_dropped++;
+        return m_device->write(size);
+    }
+
+    // Keep a copy before the device takes the buffer
+    const unsigned int head = m_head;
+    memcpy(&m_blocks[(head % m_depth) * _settings.bufSize], m_device->buffer(), size * sizeof(short));
+    m_sizes[head % m_depth] = size;
+    m_head.store(head + 1, std::memory_order_release);
+    notify();
+
+    return m_device->write(size);
+}
+
+void Audio_Tee::record()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wakeup.wait(lock, [this] {
+                return (m_head.load(std::memory_order_acquire) != m_tail) || m_quit;
+            });
+        }
+
+        const unsigned int tail = m_tail;
+        if (m_head.load(std::memory_order_acquire) == tail)
+        {
+            if (m_quit)
+                break;
+            continue;
+        }
+
+        const short *block = &m_blocks[(tail % m_depth) * _settings.bufSize];
+        const uint_least32_t size = m_sizes[tail % m_depth];
+
+        // Once a recorder failed the rest is dropped
+        for (size_t i = 0; (i < m_recorders.size()) && !m_failed; i++)
+        {
+            IAudio *recorder = m_recorders[i];
+            for (uint_least32_t done = 0; done < size; )
+            {
+                const uint_least32_t n = std::min(size - done, m_recorderBufSize[i]);
+                memcpy(recorder->buffer(), block + done, n * sizeof(short));
+                if (!recorder->write(n))
+                {
+                    fail(recorder);
+                    break;
+                }
+                done += n;
+            }
+        }
+
+        m_tail.store(tail + 1, std::memory_order_release);
+        notify();
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef AUDIO_TEE_H
+#define AUDIO_TEE_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "../AudioBase.h"
+
+/*
+ * Plays on a real time device while recording to files.
+ *
+ * The player renders straight into the device buffer; each
+ * block is copied into a ring before the device gets it. A
+ * recorder thread feeds the files from the ring, copying the
+ * block into each recorder's own buffer, so that a slow disk
+ * or encoder does not hold up the device. The ring holds
+ * several seconds; when it's full the recorders miss the
+ * block rather than stall playback, and the drops are counted.
+ */
+class Audio_Tee: public AudioBase
+{
+private:  // ------------------------------------------------------- private
+    IAudio * const         m_device;
+    std::vector<IAudio*>   m_recorders;
+    std::vector<uint_least32_t> m_recorderBufSize;
+
+    const IAudio          *m_errorSource;
+
+    unsigned int                m_depth;
+    std::vector<short>          m_blocks;
+    std::vector<uint_least32_t> m_sizes;
+
+    std::atomic<unsigned int> m_head; // blocks written by the player
+    std::atomic<unsigned int> m_tail; // blocks recorded
+    std::atomic<bool>         m_quit;
+    std::atomic<bool>         m_failed;
+
+    std::mutex              m_lock;
+    std::condition_variable m_wakeup;
+    std::thread             m_thread;
+
+    // Statistics
+    unsigned int m_dropped;
+
+private:
+    void notify();
+    void record();
+    void fail(const IAudio *recorder);
+
+public:  // --------------------------------------------------------- public
+    // Takes ownership of the device
+    Audio_Tee(IAudio *device);
+    ~Audio_Tee();
+
+    // Takes ownership of the recorder, call before open
+    void add(IAudio *recorder);
+
+    bool open  (AudioConfig &cfg) override;
+    void close () override;
+    void reset () override { m_device->reset(); }
+    bool write (uint_least32_t size) override;
+    void pause () override { m_device->pause(); }
+
+    short *buffer() const override { return m_device->buffer(); }
+    void getConfig(AudioConfig &cfg) const override { m_device->getConfig(cfg); }
+
+    const char *getErrorString() const override { return m_errorSource->getErrorString(); }
+
+    // A recorder failed, playback goes on
+    bool failed() const { return m_failed; }
+    // Blocks the recorders missed
+    unsigned int dropped() const { return m_dropped; }
+};
+
+#endif // AUDIO_TEE_H
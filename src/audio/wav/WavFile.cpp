@@ -22,12 +22,12 @@
  */
 
 #include "WavFile.h"
+#include "../LoudnessMeter.h"
 
-#include <vector>
-#include <iomanip>
-#include <fstream>
 #include <new>
 
+#include <cmath>
+#include <cstddef>
 #include <cstring>
 
 // Get the lo byte (8 bit) in a dword (32 bit)
@@ -100,6 +100,12 @@ const wavHeader WavFile::defaultWavHdr =
     {0,0,0,0}              // length
 };
 
+// KSDATAFORMAT_SUBTYPE_PCM, the first two bytes are the format tag
+static const unsigned char subFormatGuid[16] =
+{
+    0x01,0x00,0x00,0x00,0x00,0x00,0x10,0x00,0x80,0x00,0x00,0xaa,0x00,0x38,0x9b,0x71
+};
+
 const listInfo WavFile::defaultListInfo =
 {
     // ASCII keywords are hexified.
@@ -123,31 +129,62 @@ WavFile::WavFile(const std::string &name) :
     riffHdr(defaultRiffHdr),
     wavHdr(defaultWavHdr),
     listHdr(defaultListInfo),
-    file(nullptr),
+    meter(nullptr),
     headerWritten(false),
     hasListInfo(false),
+    hasBext(false),
+    extensible(false),
     precision(32)
-{}
+{
+    memset(&bextHdr, 0, sizeof(bextChunk));
+    memcpy(bextHdr.chunkID, "bext", 4);
+    endian_little32(bextHdr.length, sizeof(bextChunk) - 8);
+    endian_little16(bextHdr.version, 2);
+    strncpy(bextHdr.originator, "sidplayfp", sizeof(bextHdr.originator));
+}
 
 bool WavFile::open(AudioConfig &cfg)
 {
     precision = cfg.precision;
 
-    unsigned short bits       = precision;
-    unsigned short format     = (precision == 16) ? 1 : 3;
+    const SampleConverter::format_t sampleFormat = (precision == 16) ? SampleConverter::S16_LE
+        : (precision == 24) ? SampleConverter::S24_LE : SampleConverter::F32_LE;
+
+    unsigned short bits       = SampleConverter::bytesPerSample(sampleFormat) * 8;
+    unsigned short format     = (sampleFormat == SampleConverter::F32_LE) ? 3 : 1;
     unsigned short channels   = cfg.channels;
     unsigned long  freq       = cfg.frequency;
     unsigned short blockAlign = (bits>>3)*channels;
-    unsigned long  bufSize    = freq * blockAlign;
+    // One second of samples
+    unsigned long  bufSize    = freq * channels;
     cfg.bufSize = bufSize;
 
+    // More than two channels or 16 bits need the extensible
+    // format, which tells the sample type in a GUID
+    extensible = (channels > 2) || (bits > 16);
+    endian_little32(wavHdr.subChunkLen, extensible ? 16 + sizeof(wavExtension) : 16);
+    if (extensible)
+    {
+        // The chips are not speakers, multichannel is left unassigned
+        const uint_least32_t channelMask = (channels == 1) ? 0x4   // front center
+            : (channels == 2) ? 0x3                               // front left and right
+            : 0;
+        endian_little16(extHdr.cbSize, sizeof(wavExtension) - 2);
+        endian_little16(extHdr.validBits, bits);
+        endian_little32(extHdr.channelMask, channelMask);
+        memcpy(extHdr.subFormat, subFormatGuid, sizeof(subFormatGuid));
+        endian_little16(extHdr.subFormat, format);
+        format = 0xfffe;
+    }
+
     if (name.empty())
         return false;
 
-    if (file && !file->fail())
+    if (file.isOpen())
         close();
 
     dataSize = 0;
+    headerWritten = false;
 
     // We need to make a buffer for the user
     try
@@ -160,8 +197,16 @@ bool WavFile::open(AudioConfig &cfg)
         return false;
     }
 
+    if (!converter.setup(sampleFormat, bufSize))
+    {
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError("Unable to allocate memory for sample buffers.");
+        return false;
+    }
+
     // Fill in header with parameters and expected file size.
-    endian_little32(riffHdr.length, sizeof(riffHeader)+sizeof(wavHeader)-8);
+    endian_little32(riffHdr.length, sizeof(riffHeader)+sizeof(wavHeader)+(extensible ? sizeof(wavExtension) : 0)-8);
     endian_little16(wavHdr.channels, channels);
     endian_little16(wavHdr.format, format);
     endian_little32(wavHdr.sampleFreq, freq);
@@ -170,76 +215,121 @@ bool WavFile::open(AudioConfig &cfg)
     endian_little16(wavHdr.bitsPerSample, bits);
     endian_little32(wavHdr.dataChunkLen, 0);
 
-    if (name.compare("-") == 0)
+    if (!file.open(name))
     {
-        file = &std::cout;
+        delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
+        setError(file.error());
+        return false;
     }
-    else
+
+    if (cfg.length)
     {
-        file = new std::ofstream(name.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+        const uint_least64_t frames = (uint_least64_t)cfg.length * freq / 1000;
+        file.preallocate(sizeof(riffHeader) + sizeof(listInfo) + sizeof(bextChunk) + sizeof(wavHeader) + sizeof(wavExtension) + frames * blockAlign);
     }
 
     _settings = cfg;
     return true;
 }
 
+// Collect the header chunks in one piece
+size_t WavFile::header(char *buf) const
+{
+    size_t size = 0;
+    memcpy(buf + size, &riffHdr, sizeof(riffHeader));
+    size += sizeof(riffHeader);
+    if (hasListInfo)
+    {
+        memcpy(buf + size, &listHdr, sizeof(listInfo));
+        size += sizeof(listInfo);
+    }
+    if (hasBext)
+    {
+        memcpy(buf + size, &bextHdr, sizeof(bextChunk));
+        size += sizeof(bextChunk);
+    }
+    // The extension goes at the end of the fmt chunk, before data
+    const size_t fmtSize = offsetof(wavHeader, dataChunkID);
+    memcpy(buf + size, &wavHdr, fmtSize);
+    size += fmtSize;
+    if (extensible)
+    {
+        memcpy(buf + size, &extHdr, sizeof(wavExtension));
+        size += sizeof(wavExtension);
+    }
+    memcpy(buf + size, wavHdr.dataChunkID, sizeof(wavHeader) - fmtSize);
+    size += sizeof(wavHeader) - fmtSize;
+    return size;
+}
+
 bool WavFile::write(uint_least32_t size)
 {
-    if (file && !file->fail())
+    if (!file.isOpen())
     {
-        unsigned long int bytes = size;
-        if (!headerWritten)
-        {
-            file->write((char*)&riffHdr, sizeof(riffHeader));
-            if (hasListInfo)
-                file->write((char*)&listHdr, sizeof(listInfo));
-            file->write((char*)&wavHdr, sizeof(wavHeader));
-            headerWritten = true;
-        }
+        setError("File not open.");
+        return false;
+    }
 
-        /* XXX endianness... */
-        if (precision == 16)
+    if (!headerWritten)
+    {
+        // The header can't be fixed later on a pipe,
+        // mark the lengths as unknown as streaming readers expect
+        if (!file.seekable())
         {
-            bytes *= 2;
-            file->write((char*)_sampleBuffer, bytes);
+            endian_little32(riffHdr.length, 0xffffffff);
+            endian_little32(wavHdr.dataChunkLen, 0xffffffff);
+            // Loudness is known only at the end
+            hasBext = false;
         }
         else
         {
-            std::vector<float> buffer(size);
-            bytes *= 4;
-            // normalize floats
-            for (unsigned long i=0; i<size; i++)
-            {
-                buffer[i] = ((float)_sampleBuffer[i])/32768.f;
-            }
-            file->write((char*)&buffer.front(), bytes);
+            hasBext = (meter != nullptr);
         }
-        dataSize += bytes;
+
+        char buf[sizeof(riffHeader) + sizeof(listInfo) + sizeof(bextChunk) + sizeof(wavHeader) + sizeof(wavExtension)];
+        file.write(buf, header(buf));
+        headerWritten = true;
+    }
+
+    const unsigned long int bytes = size * converter.bytesPerSample();
+    if (!file.write(converter.convert(_sampleBuffer, size), bytes))
+    {
+        setError(file.error());
+        return false;
     }
+    dataSize += bytes;
     return true;
 }
 
 void WavFile::close()
 {
-    if (file && !file->fail())
+    if (file.isOpen())
     {
         // update length fields in header
         unsigned long int headerSize = sizeof(riffHeader)+sizeof(wavHeader)-8;
+        if (extensible)
+            headerSize += sizeof(wavExtension);
         if (hasListInfo)
             headerSize += sizeof(listInfo);
+        if (hasBext)
+        {
+            headerSize += sizeof(bextChunk);
+            setLoudnessFields();
+        }
         endian_little32(riffHdr.length, headerSize+dataSize);
         endian_little32(wavHdr.dataChunkLen, dataSize);
-        if (file != &std::cout)
+
+        // Patch the header in place once all data is out
+        if (file.flush() && file.seekable())
         {
-            file->seekp(0, std::ios::beg);
-            file->write((char*)&riffHdr, sizeof(riffHeader));
-            if (hasListInfo)
-                file->write((char*)&listHdr, sizeof(listInfo));
-            file->write((char*)&wavHdr, sizeof(wavHeader));
-            delete file;
+            char buf[sizeof(riffHeader) + sizeof(listInfo) + sizeof(bextChunk) + sizeof(wavHeader) + sizeof(wavExtension)];
+            file.pwrite(buf, header(buf), 0);
         }
-        file = nullptr;
+        if (!file.close())
+            setError(file.error());
         delete[] _sampleBuffer;
+        _sampleBuffer = nullptr;
     }
 }
 
@@ -250,3 +340,26 @@ void WavFile::setInfo(const char* title, const char* author, const char* release
     memcpy(listHdr.artist, author, 32);
     memcpy(listHdr.released, released, 32);
 }
+
+void WavFile::setLoudness(const LoudnessMeter *meter)
+{
+    this->meter = meter;
+}
+
+// Values in hundredths, 0x7fff when unknown
+static void loudnessField(unsigned char field[2], double value)
+{
+    const uint_least16_t v = (LoudnessMeter::silent(value) || (value > 327.))
+        ? 0x7fff : (uint_least16_t)(int_least16_t)std::floor(value * 100. + 0.5);
+    endian_little16(field, v);
+}
+
+void WavFile::setLoudnessFields()
+{
+    const LoudnessMeter::result_t &result = meter->result();
+    loudnessField(bextHdr.loudnessValue, result.integrated);
+    loudnessField(bextHdr.loudnessRange, result.range);
+    loudnessField(bextHdr.maxTruePeakLevel, result.truePeak);
+    loudnessField(bextHdr.maxMomentaryLoudness, result.maxMomentary);
+    loudnessField(bextHdr.maxShortTermLoudness, result.maxShortTerm);
+}
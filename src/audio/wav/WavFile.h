@@ -28,6 +28,8 @@
 #include <string>
 
 #include "../AudioBase.h"
+#include "../SampleConverter.h"
+#include "../FileWriter.h"
 
 struct riffHeader                       // little endian format
 {
@@ -39,8 +41,8 @@ struct riffHeader                       // little endian format
 struct wavHeader                        // little endian format
 {
     char subChunkID[4];                 // 'fmt ' (ASCII)
-    char subChunkLen[4];                // length of subChunk, always 16 bytes
-    unsigned char format[2];            // 1 = PCM, 3 = IEEE float
+    unsigned char subChunkLen[4];       // length of subChunk, 16 bytes or 40 when extensible
+    unsigned char format[2];            // 1 = PCM, 3 = IEEE float, 0xfffe = extensible
 
     unsigned char channels[2];          // 1 = mono, 2 = stereo
     unsigned char sampleFreq[4];        // sample-frequency
@@ -53,6 +55,14 @@ struct wavHeader                        // little endian format
     unsigned char dataChunkLen[4];      // length of data
 };
 
+struct wavExtension                     // little endian format, follows bitsPerSample
+{
+    unsigned char cbSize[2];            // size of the extension, always 22 bytes
+    unsigned char validBits[2];         // bits used in each sample
+    unsigned char channelMask[4];       // speaker positions of the channels
+    unsigned char subFormat[16];        // format GUID, PCM or IEEE float
+};
+
 struct listInfo                         // little endian format
 {
     char mainChunkID[4];                // 'LIST' (ASCII)
@@ -73,6 +83,28 @@ struct listInfo                         // little endian format
     char released[32];
 };
 
+struct bextChunk                        // little endian format, EBU Tech 3285 v2
+{
+    char chunkID[4];                    // 'bext' (ASCII)
+    unsigned char length[4];            // chunk length, always 602 bytes
+    char description[256];
+    char originator[32];
+    char originatorReference[32];
+    char originationDate[10];           // yyyy:mm:dd
+    char originationTime[8];            // hh:mm:ss
+    unsigned char timeReference[8];     // first sample count since midnight
+    unsigned char version[2];           // 2, with loudness
+    unsigned char umid[64];
+    unsigned char loudnessValue[2];     // integrated loudness, LUFS * 100
+    unsigned char loudnessRange[2];     // LU * 100
+    unsigned char maxTruePeakLevel[2];  // dBTP * 100
+    unsigned char maxMomentaryLoudness[2];
+    unsigned char maxShortTermLoudness[2];
+    unsigned char reserved[180];
+};
+
+class LoudnessMeter;
+
 /*
  * A basic WAV output file type
  * Initial implementation by Michael Schwendt <mschwendt@yahoo.com>
@@ -90,25 +122,41 @@ private:
     static const wavHeader defaultWavHdr;
     wavHeader wavHdr;
 
+    wavExtension extHdr;
+
     static const listInfo defaultListInfo;
     listInfo listHdr;
 
-    std::ostream *file;
+    bextChunk bextHdr;
+    const LoudnessMeter *meter;
+
+    FileWriter file;
     bool headerWritten;
     bool hasListInfo;
+    bool hasBext;
+    bool extensible;
     int precision;
 
+    SampleConverter converter;
+
+private:
+    size_t header(char *buf) const;
+    void setLoudnessFields();
+
 public:
     WavFile(const std::string &name);
     ~WavFile() { close(); }
 
     static const char *extension () { return ".wav"; }
 
-    // Only signed 16-bit and 32bit float samples are supported.
+    // Signed 16-bit, 24-bit and 32bit float samples are supported.
     // Endian-ess is adjusted if necessary.
     //
-    // If number of sample bytes is given, this can speed up the
-    // process of closing a huge file on slow storage media.
+    // If the expected length is given in the config, disk space
+    // is reserved up front where the filesystem supports it.
+    //
+    // When the output is not seekable, e.g. a pipe, the length
+    // fields are set to 0xffffffff as the size is unknown.
 
     bool open(AudioConfig &cfg) override;
 
@@ -120,10 +168,14 @@ public:
     void reset() override {}
 
     // Stream state.
-    bool fail() const { return (file->fail() != 0); }
-    bool bad()  const { return (file->bad()  != 0); }
+    bool fail() const { return file.failed(); }
+    bool bad()  const { return file.failed(); }
 
     void setInfo(const char* title, const char* author, const char* released);
+
+    // Store the loudness measured by the meter in a broadcast
+    // extension chunk, filled in on close. Seekable files only.
+    void setLoudness(const LoudnessMeter *meter);
 };
 
 #endif /* WAV_FILE_H */
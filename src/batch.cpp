@@ -0,0 +1,365 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+
+#include "fileutils.h"
+#include "sidcxx11.h"
+
+using std::cerr;
+using std::endl;
+
+BatchRenderer::BatchRenderer(const renderSettings &settings, unsigned int quietLevel) :
+    m_settings(settings),
+    m_quietLevel(quietLevel),
+    m_next(0),
+    m_abort(false),
+    m_total(0),
+    m_done(0),
+    m_failed(0) {}
+
+bool BatchRenderer::addInput(const std::string &path, const std::string &outDir) {
+    if (path.empty())
+        return true;
+
+    if (path[0] == '@') { // List of files, one per line
+        std::ifstream list(path.c_str() + 1);
+        if (!list.is_open()) {
+            cerr << path.c_str() + 1 << ": " << strerror(errno) << endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty() && line[line.length() - 1] == '\r')
+                line.erase(line.length() - 1);
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (!addInput(line, outDir))
+                return false;
+        }
+        return true;
+    }
+
+    if (isDirectory(path)) {
+        addDirectory(path, outDir);
+        return true;
+    }
+
+    if (!makePath(outDir)) {
+        cerr << outDir << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    addTune(path, joinPath(outDir, baseName(path)));
+    return true;
+}
+
+void BatchRenderer::addTune(const std::string &file, const std::string &outBase) {
+    input_t input;
+    input.file    = file;
+    input.outBase = outBase;
+    m_inputs.push_back(input);
+}
+
+// Scan a directory tree mirroring its layout in the output directory
+void BatchRenderer::addDirectory(const std::string &path, const std::string &outDir) {
+    std::vector<std::string> entries;
+    if (!listDirectory(path, entries)) {
+        cerr << path << ": " << strerror(errno) << endl;
+        return;
+    }
+
+    bool created = false;
+    for (std::vector<std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        const std::string entryPath(joinPath(path, *it));
+
+        if (isDirectory(entryPath)) {
+            addDirectory(entryPath, joinPath(outDir, *it));
+        }
+        else if (isTuneFile(*it)) {
+            if (!created) {
+                if (!makePath(outDir)) {
+                    cerr << outDir << ": " << strerror(errno) << endl;
+                    return;
+                }
+                created = true;
+            }
+
+            addTune(entryPath, joinPath(outDir, baseName(*it)));
+        }
+    }
+}
+
+void BatchRenderer::report(const std::string &file, unsigned int song, bool ok, const char *error, uint_least32_t endTime) {
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    m_done++;
+    if (!ok) {
+        m_failed++;
+        if (!m_abort) {
+            cerr << file;
+            if (song)
+                cerr << " [" << song << ']';
+            cerr << ": " << error << endl;
+        }
+    }
+    else if (m_quietLevel < 2) {
+        cerr << '[' << m_done << '/' << m_total << "] " << file << " [" << song << ']';
+        if (endTime) {
+            cerr << " ended at " << (endTime / 60000) << ':'
+                 << std::setw(2) << std::setfill('0') << ((endTime / 1000) % 60) << '.'
+                 << std::setw(3) << (endTime % 1000) << std::setfill(' ');
+        }
+        cerr << endl;
+    }
+}
+
+// Load a tune and create a job for each selected song
+void BatchRenderer::plan(size_t n, SidTune &tune) {
+    const input_t &input = m_inputs[n];
+
+    if (!Renderer::loadTune(tune, input.file, m_settings.hvscBase)) {
+        report(input.file, 0, false, tune.statusString());
+        return;
+    }
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    if (!m_settings.lengthValid)
+        m_settings.tuneMD5(tune, input.file, md5);
+
+    unsigned int first = 1;
+    unsigned int last  = tune.getInfo()->songs();
+    if (m_settings.single) {
+        first = tune.selectSong(m_settings.first);
+        last  = first;
+    }
+
+    for (unsigned int song = first; song <= last; song++) {
+        const int_least32_t dbLength = m_settings.lengthValid ? -1 : m_settings.songLength(md5, song);
+
+        job_t job;
+        job.input  = n;
+        job.song   = song;
+        job.stop   = m_settings.stopTime(dbLength);
+        if (!job.stop) {
+            report(input.file, song, false, "ERROR: start time exceeds song length!");
+            continue;
+        }
+        job.length = job.stop - m_settings.start;
+        job.detectEnd = !m_settings.lengthValid && (dbLength <= 0);
+        m_plans[n].push_back(job);
+    }
+}
+
+void BatchRenderer::planner() {
+    SidTune tune(nullptr);
+
+    for (;;) {
+        const size_t n = m_next++;
+        if ((n >= m_inputs.size()) || m_abort)
+            break;
+        plan(n, tune);
+    }
+}
+
+// Sort the jobs longest first and deal them out,
+// each one to the worker with the least work queued
+void BatchRenderer::schedule(unsigned int threads) {
+    std::vector<job_t> jobs;
+    for (std::vector<std::vector<job_t> >::const_iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+        jobs.insert(jobs.end(), it->begin(), it->end());
+
+    std::stable_sort(jobs.begin(), jobs.end(),
+        [](const job_t &a, const job_t &b) { return a.length > b.length; });
+
+    m_queues.clear();
+    m_queues.resize(threads);
+    for (std::vector<job_t>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+        queue_t *target = &m_queues[0];
+        for (std::deque<queue_t>::iterator q = m_queues.begin(); q != m_queues.end(); ++q) {
+            if (q->load < target->load)
+                target = &*q;
+        }
+        target->jobs.push_back(*it);
+        target->load += it->length;
+        target->count++;
+    }
+}
+
+// Take the longest job from our own queue or,
+// when it's empty, from the most loaded one
+bool BatchRenderer::nextJob(unsigned int worker, job_t &job) {
+    queue_t *queue = &m_queues[worker];
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(queue->lock);
+            if (!queue->jobs.empty()) {
+                job = queue->jobs.front();
+                queue->jobs.pop_front();
+                queue->load -= job.length;
+                queue->count--;
+                return true;
+            }
+        }
+
+        queue_t *victim = nullptr;
+        uint_least64_t maxLoad = 0;
+        for (std::deque<queue_t>::iterator q = m_queues.begin(); q != m_queues.end(); ++q) {
+            const uint_least64_t load = q->load;
+            if (q->count && (!victim || load > maxLoad)) {
+                victim  = &*q;
+                maxLoad = load;
+            }
+        }
+        if (!victim)
+            return false;
+        queue = victim;
+    }
+}
+
+void BatchRenderer::worker(unsigned int id) {
+    Renderer renderer(m_settings, m_abort);
+
+    job_t job;
+    while (!m_abort && nextJob(id, job)) {
+        const input_t &input = m_inputs[job.input];
+        const bool ok = renderer.load(input.file)
+            && renderer.render(job.song, input.outBase, job.stop, job.detectEnd);
+        report(input.file, job.song, ok, renderer.error(), renderer.endTime());
+    }
+}
+
+bool BatchRenderer::run(unsigned int threads) {
+    if (m_inputs.empty()) {
+        cerr << "ERROR: no tunes to render" << endl;
+        return false;
+    }
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+
+    // Read tunes and song lengths
+    m_plans.assign(m_inputs.size(), std::vector<job_t>());
+    for (unsigned int i = 0; (i < threads) && (i < m_inputs.size()); i++)
+        workers.push_back(std::thread(&BatchRenderer::planner, this));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+    workers.clear();
+
+    size_t jobs = 0;
+    for (std::vector<std::vector<job_t> >::const_iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+        jobs += it->size();
+
+    m_total = m_done + jobs;
+    if (threads > jobs)
+        threads = jobs;
+
+    // Render
+    if (threads) {
+        schedule(threads);
+        for (unsigned int i = 0; i < threads; i++)
+            workers.push_back(std::thread(&BatchRenderer::worker, this, i));
+        for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+            it->join();
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    if (m_quietLevel < 3) {
+        cerr << "Rendered " << (m_done - m_failed) << '/' << m_total << " songs";
+        if (m_failed)
+            cerr << " (" << m_failed << " failed)";
+        cerr << " in " << std::fixed << std::setprecision(1) << elapsed.count() << "s using "
+             << threads << " thread" << ((threads != 1) ? "s" : "") << endl;
+    }
+
+    return !m_failed && !m_abort && (m_done == m_total);
+}
+
+// Settings shared by the file rendering modes
+void ConsolePlayer::renderConfig(renderSettings &settings) {
+    settings.engCfg          = m_engCfg;
+    settings.sid             = m_driver.sid;
+    settings.output          = m_driver.output;
+    settings.info            = m_driver.info;
+    settings.loudness        = m_driver.loudness;
+    settings.channels        = m_channels;
+    settings.precision       = m_precision;
+    settings.rates           = m_driver.rates;
+    settings.detectEnd       = m_silence.enabled;
+    settings.silenceThreshold = m_silence.threshold;
+    settings.silenceHold     = m_silence.hold;
+    settings.filter          = m_filter.enabled;
+    settings.bias            = m_filter.bias;
+    settings.filterCurve6581 = m_filter.filterCurve6581;
+    settings.filterCurve8580 = m_filter.filterCurve8580;
+    for (int i = 0; i < 9; i++)
+        settings.mute[i] = vMute[i];
+    settings.single          = m_track.single;
+    settings.first           = m_track.first;
+    settings.start           = m_timer.start;
+    settings.length          = m_timer.length;
+    settings.lengthValid     = m_timer.valid;
+    settings.defaultLength   = (m_iniCfg.sidplayfp()).recordLength;
+    settings.warmup          = m_timer.warmup;
+    settings.kernalRom       = m_roms.get(RomCache::KERNAL);
+    settings.basicRom        = m_roms.get(RomCache::BASIC);
+    settings.chargenRom      = m_roms.get(RomCache::CHARGEN);
+    settings.songlengths     = m_songlengths.isOpen() ? &m_songlengths : nullptr;
+    settings.database        = &m_database;
+    settings.newSonglengthDB = newSonglengthDB;
+    settings.hvscBase        = getenv("HVSC_BASE");
+    settings.md5Cache        = m_md5Cache.isOpen() ? &m_md5Cache : nullptr;
+}
+
+// Batch rendering entry point
+bool ConsolePlayer::batch() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    BatchRenderer renderer(settings, m_quietLevel);
+    for (std::vector<std::string>::const_iterator it = m_batch.inputs.begin(); it != m_batch.inputs.end(); ++it) {
+        if (!renderer.addInput(*it, m_batch.outDir))
+            return false;
+    }
+
+    m_batchRenderer = &renderer;
+    const bool ret = renderer.run(m_batch.threads);
+    m_batchRenderer = nullptr;
+    return ret;
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+
+#include "renderer.h"
+
+/*
+ * Renders a list of tunes to files using a pool
+ * of worker threads, each one with its own engine.
+ *
+ * Every subtune is a separate job. Lengths are read
+ * from the songlength DB up front and jobs are run
+ * longest first, idle workers stealing from the busiest
+ * ones, so the total time is bounded by the longest
+ * subtune rather than by the sum of a tune's songs.
+ */
+class BatchRenderer {
+private:
+    struct input_t {
+        std::string file;
+        std::string outBase; // output name without tune number and extension
+    };
+
+    struct job_t {
+        size_t         input;
+        unsigned int   song;
+        uint_least32_t stop;   // ms
+        uint_least32_t length; // expected render length in ms
+        bool           detectEnd; // length not known, end on silence
+    };
+
+    struct queue_t {
+        std::mutex          lock;
+        std::deque<job_t>   jobs;   // sorted longest first
+        std::atomic<uint_least64_t> load;  // sum of the queued lengths
+        std::atomic<size_t>         count; // jobs queued, read without the lock
+
+        queue_t() : load(0), count(0) {}
+    };
+
+private:
+    const renderSettings &m_settings;
+    const unsigned int    m_quietLevel;
+
+    std::vector<input_t>            m_inputs;
+    std::vector<std::vector<job_t>> m_plans;   // jobs per input
+    std::deque<queue_t>             m_queues;  // one per worker
+
+    std::atomic<size_t> m_next;
+    std::atomic<bool>   m_abort;
+
+    std::mutex   m_outputLock;
+    size_t       m_total;
+    unsigned int m_done;
+    unsigned int m_failed;
+
+private:
+    void addDirectory(const std::string &path, const std::string &outDir);
+
+    void planner();
+    void plan(size_t n, SidTune &tune);
+    void schedule(unsigned int threads);
+
+    bool nextJob(unsigned int worker, job_t &job);
+    void worker(unsigned int id);
+
+    void report(const std::string &file, unsigned int song, bool ok, const char *error, uint_least32_t endTime = 0);
+
+public:
+    BatchRenderer(const renderSettings &settings, unsigned int quietLevel);
+
+    // Add a tune, a directory to be scanned recursively
+    // or a list of files if prefixed by '@'
+    bool addInput(const std::string &path, const std::string &outDir);
+
+    // Add a single tune with the given output name
+    void addTune(const std::string &file, const std::string &outBase);
+
+    size_t inputs() const { return m_inputs.size(); }
+    const std::string &inputFile(size_t n) const { return m_inputs[n].file; }
+    const std::string &outputBase(size_t n) const { return m_inputs[n].outBase; }
+
+    bool run(unsigned int threads);
+
+    // Can be called from a signal handler
+    void stop() { m_abort = true; }
+};
+
+#endif // BATCH_H
@@ -0,0 +1,150 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "fileutils.h"
+
+#include <algorithm>
+
+#include <cctype>
+#include <cerrno>
+
+#include "sidcxx11.h"
+
+#ifndef _WIN32
+# include <sys/types.h>
+# include <sys/stat.h>  /* mkdir */
+# include <dirent.h>    /* opendir */
+# include <unistd.h>    /* getcwd */
+#else
+# include <windows.h>
+#endif
+
+// Wide-chars are not yet supported here
+#undef  SEPARATOR
+#define SEPARATOR "/"
+
+// Get the file name without directory and extension
+std::string baseName(const std::string &path) {
+    const size_t sep = path.find_last_of("/\\");
+    std::string name((sep == std::string::npos) ? path : path.substr(sep + 1));
+    const size_t dot = name.find_last_of('.');
+    if (dot != std::string::npos && dot != 0)
+        name.erase(dot);
+    return name;
+}
+
+std::string joinPath(const std::string &dir, const std::string &name) {
+    if (dir.empty())
+        return name;
+    std::string path(dir);
+    if (path[path.length() - 1] != '/')
+        path.append(SEPARATOR);
+    return path.append(name);
+}
+
+static const char *tuneExtensions[] = { ".sid", ".psid", ".prg", ".p00", ".mus", ".str", nullptr };
+
+bool isTuneFile(const std::string &name) {
+    const size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string ext(name.substr(dot));
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    for (int i = 0; tuneExtensions[i]; i++) {
+        if (ext.compare(tuneExtensions[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool isDirectory(const std::string &path) {
+#ifndef _WIN32
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+#else
+    const DWORD attr = GetFileAttributesA(path.c_str());
+    return (attr != INVALID_FILE_ATTRIBUTES) && (attr & FILE_ATTRIBUTE_DIRECTORY);
+#endif
+}
+
+std::string absolutePath(const std::string &path) {
+    if (path.empty() || (path[0] == '/') || (path[0] == '\\'))
+        return path;
+#ifdef _WIN32
+    if ((path.length() > 1) && (path[1] == ':'))
+        return path;
+#endif
+
+    char cwd[4096];
+#ifndef _WIN32
+    if (!getcwd(cwd, sizeof(cwd)))
+        return path;
+#else
+    if (!GetCurrentDirectoryA(sizeof(cwd), cwd))
+        return path;
+#endif
+    return joinPath(cwd, path);
+}
+
+// Create a directory and all its parents
+bool makePath(const std::string &path) {
+    size_t pos = 0;
+    do {
+        pos = path.find_first_of("/\\", pos + 1);
+        const std::string dir(path.substr(0, pos));
+#ifndef _WIN32
+        if ((mkdir(dir.c_str(), 0755) < 0) && (errno != EEXIST))
+            return false;
+#else
+        if (!CreateDirectoryA(dir.c_str(), NULL) && (GetLastError() != ERROR_ALREADY_EXISTS))
+            return false;
+#endif
+    } while (pos != std::string::npos);
+    return true;
+}
+
+// List directory entries, sorted by name
+bool listDirectory(const std::string &path, std::vector<std::string> &entries) {
+#ifndef _WIN32
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return false;
+
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] != '.')
+            entries.push_back(entry->d_name);
+    }
+    closedir(dir);
+#else
+    WIN32_FIND_DATAA data;
+    HANDLE hFind = FindFirstFileA(joinPath(path, "*").c_str(), &data);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return false;
+
+    do {
+        if (data.cFileName[0] != '.')
+            entries.push_back(data.cFileName);
+    } while (FindNextFileA(hFind, &data));
+    FindClose(hFind);
+#endif
+    std::sort(entries.begin(), entries.end());
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef FILEUTILS_H
+#define FILEUTILS_H
+
+#include <string>
+#include <vector>
+
+// Get the file name without directory and extension
+std::string baseName(const std::string &path);
+
+std::string joinPath(const std::string &dir, const std::string &name);
+
+bool isDirectory(const std::string &path);
+
+// Check the extension for a known tune format
+bool isTuneFile(const std::string &name);
+
+// Prepend the current directory to relative paths
+std::string absolutePath(const std::string &path);
+
+// Create a directory and all its parents
+bool makePath(const std::string &path);
+
+// List directory entries, sorted by name
+bool listDirectory(const std::string &path, std::vector<std::string> &entries);
+
+#endif // FILEUTILS_H
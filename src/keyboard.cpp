@@ -98,6 +98,10 @@ static char keytable[] = {
     'q',0,                     A_QUIT,
     'g',0,                     A_GOTO,
     'r',0,                     A_REPLAY,
+    '[',0,                     A_SEEK_BACK,
+    ']',0,                     A_SEEK_FORWARD,
+    '{',0,                     A_SEEK_BACK_LONG,
+    '}',0,                     A_SEEK_FORWARD_LONG,
 
     // Old Keys
     '<',0,                     A_LEFT_ARROW,
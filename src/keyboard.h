@@ -46,6 +46,10 @@ enum {
     A_QUIT,
     A_GOTO,
     A_REPLAY,
+    A_SEEK_BACK,
+    A_SEEK_FORWARD,
+    A_SEEK_BACK_LONG,
+    A_SEEK_FORWARD_LONG,
 
     /* Debug */
     A_TOGGLE_VOICE1,
@@ -0,0 +1,579 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "looplength.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include "fileutils.h"
+#include "audio/AudioConfig.h"
+#include "sidcxx11.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// Time between two samples of the registers, in ms
+const uint_least32_t STEP_MS = 10;
+
+// Output of the scanning engine, just enough to keep it running
+const uint_least32_t SCAN_RATE = 16000;
+
+// Shortest loop accepted
+const uint_least32_t MIN_LOOP = 2000;
+
+// A loop must repeat for at least this long, and at least
+// one period, so repeated bars are not taken for it
+const uint_least32_t MIN_CONFIRM = 30000;
+
+// The song has ended when the registers don't change for this long
+const uint_least32_t END_HOLD = 15000;
+
+// Steps checked behind a new candidate period
+const uint_least32_t VERIFY_STEPS = 100;
+
+// Earlier occurrences of a state tried as candidates
+const unsigned int MAX_CANDIDATES = 16;
+
+// Mismatches allowed in a row and overall, one in MISS_RATIO
+const unsigned int MAX_MISSES = 3;
+const unsigned int MISS_RATIO = 8;
+
+// Time limit when not set with -t
+const uint_least32_t MAX_SCAN_TIME = 15 * 60 * 1000;
+
+// Registers written by the tunes, the rest can be read only
+const unsigned int SID_REGISTERS = 0x19;
+
+void LoopDetector::reset() {
+    m_states.clear();
+    m_times.clear();
+    m_seen.clear();
+    m_lastChange = 0;
+    m_period     = 0;
+    m_runStart   = 0;
+    m_misses     = 0;
+    m_missTotal  = 0;
+    m_status     = SCANNING;
+    m_length     = 0;
+    m_loop       = 0;
+}
+
+// Compare a step with the one a period back,
+// allowing for a step of jitter
+bool LoopDetector::matches(uint_least32_t t, uint_least32_t period) const {
+    const uint_least32_t u = t - period;
+    const uint_least64_t state = m_states[t];
+    return (state == m_states[u])
+        || ((u > 0) && (state == m_states[u - 1]))
+        || ((u + 1 < t) && (state == m_states[u + 1]));
+}
+
+// Try the latest earlier occurrences of the state at t,
+// shortest period first
+void LoopDetector::findCandidate(uint_least32_t t) {
+    std::unordered_map<uint_least64_t, std::vector<uint_least32_t>>::const_iterator it = m_seen.find(m_states[t]);
+    if (it == m_seen.end())
+        return;
+
+    unsigned int tried = 0;
+    for (std::vector<uint_least32_t>::const_reverse_iterator s = it->second.rbegin();
+         (s != it->second.rend()) && (tried < MAX_CANDIDATES); ++s) {
+        if (m_times[t] - m_times[*s] < MIN_LOOP)
+            continue;
+        tried++;
+        if (*s <= VERIFY_STEPS)
+            break;
+
+        const uint_least32_t period = t - *s;
+        unsigned int misses = 0;
+        for (uint_least32_t i = 0; i < VERIFY_STEPS; i++) {
+            if (!matches(t - i, period))
+                misses++;
+        }
+        if (misses * MISS_RATIO <= VERIFY_STEPS) {
+            m_period    = period;
+            m_runStart  = t - VERIFY_STEPS + 1;
+            m_misses    = 0;
+            m_missTotal = misses;
+            return;
+        }
+    }
+}
+
+LoopDetector::status_t LoopDetector::add(uint_least64_t state, uint_least32_t time) {
+    if (m_status != SCANNING)
+        return m_status;
+
+    const uint_least32_t t = m_states.size();
+    m_states.push_back(state);
+    m_times.push_back(time);
+
+    const bool changed = (t == 0) || (state != m_states[t - 1]);
+    if (changed) {
+        m_lastChange = t;
+    }
+    else if (time - m_times[m_lastChange] >= END_HOLD) {
+        // Nothing is written to the chips any more
+        m_status = ENDED;
+        m_length = m_lastChange ? m_times[m_lastChange] : 0;
+        return m_status;
+    }
+
+    if (m_period) {
+        if (matches(t, m_period)) {
+            m_misses = 0;
+        }
+        else {
+            m_misses++;
+            m_missTotal++;
+            if ((m_misses > MAX_MISSES) || (m_missTotal * MISS_RATIO > t - m_runStart + 1))
+                m_period = 0;
+        }
+    }
+
+    if (m_period) {
+        const uint_least32_t loop = time - m_times[t - m_period];
+        if (time - m_times[m_runStart] >= std::max(loop, MIN_CONFIRM)) {
+            // Go back to where the repetition began
+            uint_least32_t s = m_runStart;
+            while ((s > m_period + 1) && matches(s - 1, m_period))
+                s--;
+            // A loop of a single state is the end of the song,
+            // with only a few stray writes
+            unsigned int other = 0;
+            for (uint_least32_t i = t - m_period + 1; i < t; i++) {
+                if (m_states[i] != state)
+                    other++;
+            }
+            if (other * MISS_RATIO <= m_period) {
+                m_status = ENDED;
+                m_length = m_times[s - m_period];
+            }
+            else {
+                m_status = LOOPED;
+                m_length = m_times[s];
+                m_loop   = m_times[s] - m_times[s - m_period];
+            }
+        }
+    }
+    else if (changed) {
+        findCandidate(t);
+    }
+
+    if (changed)
+        m_seen[state].push_back(t);
+    return m_status;
+}
+
+void LoopDetector::stop(uint_least32_t time) {
+    if (m_status != SCANNING)
+        return;
+    m_status = ENDED;
+    m_length = time;
+}
+
+LengthScanner::LengthScanner(const renderSettings &settings, unsigned int quietLevel, uint_least32_t limit, bool newDB) :
+    m_settings(settings),
+    m_quietLevel(quietLevel),
+    m_limit(limit),
+    m_newDB(newDB),
+    m_next(0),
+    m_abort(false),
+    m_found(0),
+    m_failed(0) {}
+
+bool LengthScanner::addInput(const std::string &path) {
+    if (path.empty())
+        return true;
+
+    if (path[0] == '@') { // List of files, one per line
+        std::ifstream list(path.c_str() + 1);
+        if (!list.is_open()) {
+            cerr << path.c_str() + 1 << ": " << strerror(errno) << endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty() && line[line.length() - 1] == '\r')
+                line.erase(line.length() - 1);
+            if (line.empty() || line[0] == '#')
+                continue;
+            if (!addInput(line))
+                return false;
+        }
+        return true;
+    }
+
+    if (isDirectory(path)) {
+        addDirectory(path);
+        return true;
+    }
+
+    tune_t tune;
+    tune.file = path;
+    m_tunes.push_back(tune);
+    return true;
+}
+
+void LengthScanner::addDirectory(const std::string &path) {
+    std::vector<std::string> entries;
+    if (!listDirectory(path, entries)) {
+        cerr << path << ": " << strerror(errno) << endl;
+        return;
+    }
+
+    for (std::vector<std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        const std::string entryPath(joinPath(path, *it));
+        if (isDirectory(entryPath))
+            addDirectory(entryPath);
+        else if (isTuneFile(*it))
+            addInput(entryPath);
+    }
+}
+
+std::string LengthScanner::formatLength(uint_least32_t ms) const {
+    std::ostringstream sstream;
+    if (m_newDB) {
+        sstream << (ms / 60000) << ':' << std::setw(2) << std::setfill('0') << ((ms / 1000) % 60)
+                << '.' << std::setw(3) << (ms % 1000);
+    }
+    else { // Whole seconds only
+        const uint_least32_t seconds = (ms + 500) / 1000;
+        sstream << (seconds / 60) << ':' << std::setw(2) << std::setfill('0') << (seconds % 60);
+    }
+    return sstream.str();
+}
+
+void LengthScanner::reportError(const std::string &file, unsigned int song, const char *error) {
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    m_failed++;
+    if (!m_abort) {
+        cerr << file;
+        if (song)
+            cerr << " [" << song << ']';
+        cerr << ": " << error << endl;
+    }
+}
+
+void LengthScanner::report(const tune_t &tune, unsigned int song, const LoopDetector &detector) {
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    cout << tune.file << " [" << song << "]: ";
+    switch (detector.status()) {
+    case LoopDetector::LOOPED:
+        m_found++;
+        cout << "loop " << formatLength(detector.loop())
+             << " from " << formatLength(detector.length() - detector.loop())
+             << ", length " << formatLength(detector.length());
+        break;
+    case LoopDetector::ENDED:
+        if (detector.length()) {
+            m_found++;
+            cout << "ends at " << formatLength(detector.length());
+        }
+        else {
+            cout << "silent";
+        }
+        break;
+    default:
+        cout << "no loop found in " << formatLength(m_limit);
+        break;
+    }
+    cout << endl;
+}
+
+// Load a tune and create a job for each song not in the songlength DB
+void LengthScanner::plan(size_t n, SidTune &tune) {
+    tune_t &entry = m_tunes[n];
+
+    if (!Renderer::loadTune(tune, entry.file, m_settings.hvscBase)) {
+        reportError(entry.file, 0, tune.statusString());
+        return;
+    }
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    m_settings.tuneMD5(tune, entry.file, md5);
+
+    const unsigned int songs = tune.getInfo()->songs();
+    entry.lengths.assign(songs, -1);
+    for (unsigned int song = 1; song <= songs; song++) {
+        const int_least32_t length = m_settings.songLength(md5, song);
+        if (length > 0) {
+            entry.lengths[song - 1] = length;
+        }
+        else {
+            job_t job;
+            job.tune = n;
+            job.song = song;
+            m_plans[n].push_back(job);
+        }
+    }
+
+    if (m_plans[n].empty())
+        return;
+
+    // The output DB may use the other flavour
+    if (m_newDB != m_settings.newSonglengthDB)
+        ::tuneMD5(tune, entry.file, m_newDB, m_settings.md5Cache, md5);
+    entry.md5 = md5;
+}
+
+void LengthScanner::planner() {
+    SidTune tune(nullptr);
+
+    for (;;) {
+        const size_t n = m_next++;
+        if ((n >= m_tunes.size()) || m_abort)
+            break;
+        plan(n, tune);
+    }
+}
+
+// Run a song sampling the registers until it loops, ends or
+// the time limit is reached
+bool LengthScanner::scan(Renderer &renderer, unsigned int song, LoopDetector &detector) {
+    AudioConfig cfg;
+    cfg.frequency = SCAN_RATE;
+    cfg.channels  = 1;
+    cfg.bufSize   = SCAN_RATE * STEP_MS / 1000;
+
+    if (!renderer.setup(song) || !renderer.configure(cfg))
+        return false;
+
+    std::vector<short> buffer(cfg.bufSize);
+    detector.reset();
+
+    for (;;) {
+        uint_least32_t samples;
+        if (!renderer.play(&buffer[0], cfg.bufSize, m_limit, samples))
+            return false;
+        if (!samples)
+            break;
+
+        // 64-bit FNV-1a of the registers of all the chips
+        uint_least64_t state = 0xcbf29ce484222325ULL;
+        uint8_t regs[32];
+        for (unsigned int chip = 0; renderer.sidStatus(chip, regs); chip++) {
+            for (unsigned int i = 0; i < SID_REGISTERS; i++) {
+                state ^= regs[i];
+                state *= 0x100000001b3ULL;
+            }
+        }
+
+        if (detector.add(state, renderer.timeMs()) != LoopDetector::SCANNING)
+            break;
+    }
+
+    // The tune stopped the player
+    if (renderer.timeMs() + STEP_MS < m_limit)
+        detector.stop(renderer.timeMs());
+
+    renderer.stop();
+    return true;
+}
+
+void LengthScanner::worker() {
+    Renderer renderer(m_settings, m_abort);
+    LoopDetector detector;
+
+    for (;;) {
+        const size_t n = m_next++;
+        if ((n >= m_jobs.size()) || m_abort)
+            break;
+
+        const job_t &job = m_jobs[n];
+        tune_t &tune = m_tunes[job.tune];
+        if (!renderer.load(tune.file) || !scan(renderer, job.song, detector)) {
+            reportError(tune.file, job.song, renderer.error());
+            tune.lengths[job.song - 1] = 0;
+            continue;
+        }
+
+        tune.lengths[job.song - 1] = detector.length();
+        report(tune, job.song, detector);
+    }
+}
+
+bool LengthScanner::run(unsigned int threads) {
+    if (m_tunes.empty()) {
+        cerr << "ERROR: no tunes to scan" << endl;
+        return false;
+    }
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+
+    // Read tunes and song lengths
+    m_plans.assign(m_tunes.size(), std::vector<job_t>());
+    m_next = 0;
+    for (unsigned int i = 0; (i < threads) && (i < m_tunes.size()); i++)
+        workers.push_back(std::thread(&LengthScanner::planner, this));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+    workers.clear();
+
+    m_jobs.clear();
+    for (std::vector<std::vector<job_t> >::const_iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+        m_jobs.insert(m_jobs.end(), it->begin(), it->end());
+
+    // Scan
+    if (threads > m_jobs.size())
+        threads = m_jobs.size();
+    m_next = 0;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.push_back(std::thread(&LengthScanner::worker, this));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+    if (m_quietLevel < 3) {
+        cerr << "Found " << m_found << '/' << m_jobs.size() << " song lengths";
+        if (m_failed)
+            cerr << " (" << m_failed << " failed)";
+        cerr << " in " << std::fixed << std::setprecision(1) << elapsed.count() << "s using "
+             << threads << " thread" << ((threads != 1) ? "s" : "") << endl;
+    }
+
+    return !m_failed && !m_abort;
+}
+
+bool LengthScanner::write(const std::string &database) {
+    const size_t MD5_CHARS = SidTune::MD5_LENGTH;
+
+    // Keep what's already there, entries are replaced in place
+    std::vector<std::string> lines;
+    std::unordered_map<std::string, size_t> entries;
+    {
+        std::ifstream in(database.c_str());
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line[line.length() - 1] == '\r')
+                line.erase(line.length() - 1);
+            if ((line.length() > MD5_CHARS) && (line[MD5_CHARS] == '='))
+                entries[line.substr(0, MD5_CHARS)] = lines.size();
+            lines.push_back(line);
+        }
+    }
+    if (lines.empty())
+        lines.push_back("[Database]");
+
+    for (std::vector<tune_t>::const_iterator it = m_tunes.begin(); it != m_tunes.end(); ++it) {
+        // Skipped or not completely scanned
+        if (it->md5.empty() || (std::find(it->lengths.begin(), it->lengths.end(), -1) != it->lengths.end()))
+            continue;
+
+        std::string entry(it->md5);
+        entry.append("=");
+        for (std::vector<int_least32_t>::const_iterator l = it->lengths.begin(); l != it->lengths.end(); ++l) {
+            if (l != it->lengths.begin())
+                entry.append(" ");
+            entry.append(formatLength((*l > 0) ? *l : 0));
+        }
+
+        std::unordered_map<std::string, size_t>::const_iterator e = entries.find(it->md5);
+        if (e != entries.end()) {
+            lines[e->second] = entry;
+        }
+        else {
+            lines.push_back(std::string("; ").append(it->file));
+            entries[it->md5] = lines.size();
+            lines.push_back(entry);
+        }
+    }
+
+    // Replace the file only once completely written
+    const std::string tempName(database + ".tmp");
+    {
+        std::ofstream out(tempName.c_str());
+        for (std::vector<std::string>::const_iterator it = lines.begin(); it != lines.end(); ++it)
+            out << *it << '\n';
+        out.close();
+        if (out.fail()) {
+            cerr << tempName << ": " << strerror(errno) << endl;
+            std::remove(tempName.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(database.c_str());
+#endif
+    if (std::rename(tempName.c_str(), database.c_str()) != 0) {
+        cerr << database << ": " << strerror(errno) << endl;
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    if (m_quietLevel < 3)
+        cerr << "Song lengths written to " << database << endl;
+    return true;
+}
+
+// Song length scanning entry point
+bool ConsolePlayer::findLengths() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    // Only the register writes matter, use the fastest emulation
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESID_H
+    settings.sid = EMU_RESID;
+#else
+    settings.sid = EMU_RESIDFP;
+#endif
+    settings.filter = false;
+    settings.engCfg.samplingMethod = SidConfig::INTERPOLATE;
+    settings.engCfg.fastSampling   = true;
+
+    // Same rule as for the configured database
+    const std::string &database = m_batch.lengthFile;
+    const bool newDB = (database.length() > 4) && (database.compare(database.length() - 4, 4, ".md5") == 0);
+
+    LengthScanner scanner(settings, m_quietLevel, settings.lengthValid ? settings.length : MAX_SCAN_TIME, newDB);
+    for (std::vector<std::string>::const_iterator it = m_batch.inputs.begin(); it != m_batch.inputs.end(); ++it) {
+        if (!scanner.addInput(*it))
+            return false;
+    }
+
+    m_lengthScanner = &scanner;
+    const bool ret = scanner.run(m_batch.threads);
+    m_lengthScanner = nullptr;
+
+    // Whatever was found is kept
+    return scanner.write(database) && ret;
+}
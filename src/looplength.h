@@ -0,0 +1,158 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef LOOPLENGTH_H
+#define LOOPLENGTH_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+
+#include <stdint.h>
+
+#include "renderer.h"
+
+/*
+ * Finds the length of a song from the state of the SID registers,
+ * sampled at a fixed step while the tune runs.
+ *
+ * The music loops when the sequence of states starts repeating
+ * with some period: a candidate period comes from an earlier
+ * occurrence of the current state and is kept as long as the
+ * states keep matching those one period back. The engine runs in
+ * chunks of cycles, so a state may be sampled one step early or
+ * late and a few mismatches are allowed. A song also ends when
+ * nothing is written to the chips any more.
+ */
+class LoopDetector {
+public:
+    typedef enum { SCANNING, LOOPED, ENDED } status_t;
+
+private:
+    std::vector<uint_least64_t> m_states; // state hash per step
+    std::vector<uint_least32_t> m_times;  // ms
+    std::unordered_map<uint_least64_t, std::vector<uint_least32_t>> m_seen; // steps where a state begins
+
+    uint_least32_t m_lastChange;
+    uint_least32_t m_period;    // candidate in steps, 0 if none
+    uint_least32_t m_runStart;  // first step matching the candidate
+    unsigned int   m_misses;    // consecutive
+    unsigned int   m_missTotal;
+
+    status_t       m_status;
+    uint_least32_t m_length;
+    uint_least32_t m_loop;
+
+private:
+    bool matches(uint_least32_t t, uint_least32_t period) const;
+    void findCandidate(uint_least32_t t);
+
+public:
+    LoopDetector() { reset(); }
+
+    void reset();
+
+    // Add the state at the given time in ms
+    status_t add(uint_least64_t state, uint_least32_t time);
+
+    // The tune stopped the player at the given time
+    void stop(uint_least32_t time);
+
+    status_t status() const { return m_status; }
+
+    // Length in ms up to where the music repeats or ends, 0 if not known
+    uint_least32_t length() const { return m_length; }
+
+    // Loop period in ms, 0 if the song ended
+    uint_least32_t loop() const { return m_loop; }
+};
+
+/*
+ * Finds the length of every subtune of a list of tunes
+ * and writes them to a songlength DB.
+ *
+ * Each song is a job for a pool of worker threads. The tunes
+ * run with the cheapest emulation available, at a low sample
+ * rate without filter, as only the register writes matter.
+ * Songs already in the songlength DB are not scanned.
+ */
+class LengthScanner {
+private:
+    struct tune_t {
+        std::string file;
+        std::string md5;     // in the flavour of the output DB, empty if skipped
+        std::vector<int_least32_t> lengths; // ms per song, -1 until scanned
+    };
+
+    struct job_t {
+        size_t       tune;
+        unsigned int song;
+    };
+
+private:
+    const renderSettings &m_settings;
+    const unsigned int    m_quietLevel;
+    const uint_least32_t  m_limit;  // ms
+    const bool            m_newDB;  // output in the md5 format with milliseconds
+
+    std::vector<tune_t>             m_tunes;
+    std::vector<std::vector<job_t>> m_plans; // jobs per tune
+    std::vector<job_t>              m_jobs;
+
+    std::atomic<size_t> m_next;
+    std::atomic<bool>   m_abort;
+
+    std::mutex   m_outputLock;
+    unsigned int m_found;
+    unsigned int m_failed;
+
+private:
+    void addDirectory(const std::string &path);
+
+    void planner();
+    void plan(size_t n, SidTune &tune);
+    void worker();
+
+    bool scan(Renderer &renderer, unsigned int song, LoopDetector &detector);
+
+    std::string formatLength(uint_least32_t ms) const;
+    void report(const tune_t &tune, unsigned int song, const LoopDetector &detector);
+    void reportError(const std::string &file, unsigned int song, const char *error);
+
+public:
+    LengthScanner(const renderSettings &settings, unsigned int quietLevel, uint_least32_t limit, bool newDB);
+
+    // Add a tune, a directory to be scanned recursively
+    // or a list of files if prefixed by '@'
+    bool addInput(const std::string &path);
+
+    bool run(unsigned int threads);
+
+    // Merge the lengths into a songlength DB, replacing
+    // the entries of the scanned tunes
+    bool write(const std::string &database);
+
+    // Can be called from a signal handler
+    void stop() { m_abort = true; }
+};
+
+#endif // LOOPLENGTH_H
@@ -48,6 +48,52 @@ int main(int argc, char *argv[]) {
             goto main_exit;
     }
 
+    // The file modes stop cleanly on a signal,
+    // playback installs its handlers after open
+    if ((player.lengthMode() || player.spoolMode() || player.batchMode()
+         || player.segmentMode() || player.stemMode() || player.channelMode())
+        && ((signal (SIGINT,  &sighandler) == SIG_ERR)
+         || (signal (SIGTERM, &sighandler) == SIG_ERR))) {
+        displayError(argv[0], ERR_SIGHANDLER);
+        goto main_error;
+    }
+
+    if (player.lengthMode()) {
+        if (!player.findLengths())
+            goto main_error;
+        goto main_exit;
+    }
+
+    if (player.spoolMode()) {
+        if (!player.spool())
+            goto main_error;
+        goto main_exit;
+    }
+
+    if (player.batchMode()) {
+        if (!player.batch())
+            goto main_error;
+        goto main_exit;
+    }
+
+    if (player.segmentMode()) {
+        if (!player.renderSegments())
+            goto main_error;
+        goto main_exit;
+    }
+
+    if (player.stemMode()) {
+        if (!player.renderStems())
+            goto main_error;
+        goto main_exit;
+    }
+
+    if (player.channelMode()) {
+        if (!player.renderChannels())
+            goto main_error;
+        goto main_exit;
+    }
+
 main_restart:
     if (!player.open())
         goto main_error;
@@ -0,0 +1,151 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "mappedfile.h"
+
+#include <fstream>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#elif defined(HAVE_SYS_MMAN_H)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#include "sidcxx11.h"
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+#if defined(_WIN32)
+    , m_mapping(nullptr)
+#endif
+{}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (size.QuadPart == 0)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data    = static_cast<const uint8_t*>(view);
+    m_size    = (size_t) size.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+    }
+    m_mapping = nullptr;
+    m_data    = nullptr;
+    m_size    = 0;
+}
+
+#elif defined(HAVE_SYS_MMAN_H)
+
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0)) {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    m_data = static_cast<const uint8_t*>(addr);
+    m_size = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+    close();
+
+    std::ifstream is(path.c_str(), std::ios::binary);
+    if (!is.is_open())
+        return false;
+
+    is.seekg(0, is.end);
+    const std::streamoff size = is.tellg();
+    if (size <= 0)
+        return false;
+    is.seekg(0, is.beg);
+
+    m_buffer.resize(size);
+    if (!is.read((char*)&m_buffer[0], size)) {
+        m_buffer.clear();
+        return false;
+    }
+
+    m_data = &m_buffer[0];
+    m_size = m_buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+#endif
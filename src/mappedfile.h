@@ -0,0 +1,66 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <cstddef>
+
+/*
+ * Read-only view of a whole file, memory mapped when
+ * the platform allows it so that pages are shared among
+ * all the processes using the same file.
+ */
+class MappedFile {
+private:
+    const uint8_t *m_data;
+    size_t         m_size;
+
+#if defined(_WIN32)
+    void          *m_mapping;
+#elif !defined(HAVE_SYS_MMAN_H)
+    std::vector<uint8_t> m_buffer; // fallback copy
+#endif
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile();
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+
+    const uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+#endif // MAPPEDFILE_H
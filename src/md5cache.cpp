@@ -0,0 +1,209 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "md5cache.h"
+
+#include <fstream>
+#include <sstream>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "fileutils.h"
+
+#include "sidcxx11.h"
+
+namespace {
+
+const char *NO_MD5 = "-";
+
+bool isMD5(const std::string &str) {
+    if (str.length() != Md5Cache::MD5_LENGTH)
+        return false;
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        if (!isxdigit((unsigned char)*it))
+            return false;
+    }
+    return true;
+}
+
+}
+
+bool Md5Cache::fileInfo(const std::string &file, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+        return false;
+    size  = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+bool Md5Cache::open(const std::string &path) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_path = path;
+    m_entries.clear();
+    m_records = 0;
+
+    std::ifstream in(path.c_str());
+    if (!in.is_open())
+        return true; // nothing cached yet
+
+    // <size> <mtime> <old md5> <new md5> <path>
+    std::string line;
+    while (std::getline(in, line)) {
+        m_records++;
+
+        std::istringstream record(line);
+        entry_t entry;
+        if (!(record >> entry.size >> entry.mtime >> entry.md5[0] >> entry.md5[1]))
+            continue;
+
+        std::string file;
+        record.get();
+        if (!std::getline(record, file) || file.empty())
+            continue;
+
+        for (int i = 0; i < 2; i++) {
+            if (!isMD5(entry.md5[i]))
+                entry.md5[i].clear();
+        }
+        m_entries[file] = entry;
+    }
+    in.close();
+
+    if (m_records > 2 * m_entries.size() + 64)
+        compact();
+    return true;
+}
+
+// Rewrite the log without superseded records.
+// Records appended meanwhile by other processes may be lost,
+// that only costs a new hash later.
+void Md5Cache::compact() {
+    std::ostringstream tmpPath;
+#ifdef _WIN32
+    tmpPath << m_path << '.' << GetCurrentProcessId();
+#else
+    tmpPath << m_path << '.' << getpid();
+#endif
+
+    {
+        std::ofstream out(tmpPath.str().c_str());
+        if (!out.is_open())
+            return;
+
+        for (map_t::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+            const entry_t &entry = it->second;
+            out << entry.size << ' ' << entry.mtime << ' '
+                << (entry.md5[0].empty() ? NO_MD5 : entry.md5[0]) << ' '
+                << (entry.md5[1].empty() ? NO_MD5 : entry.md5[1]) << ' '
+                << it->first << '\n';
+        }
+        if (!out.good()) {
+            out.close();
+            std::remove(tmpPath.str().c_str());
+            return;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(m_path.c_str());
+#endif
+    if (std::rename(tmpPath.str().c_str(), m_path.c_str()) == 0)
+        m_records = m_entries.size();
+    else
+        std::remove(tmpPath.str().c_str());
+}
+
+// Append a record with a single write, the file is opened
+// in append mode so concurrent writers don't mix lines
+bool Md5Cache::append(const std::string &file, const entry_t &entry) {
+    std::ostringstream record;
+    record << entry.size << ' ' << entry.mtime << ' '
+           << (entry.md5[0].empty() ? NO_MD5 : entry.md5[0]) << ' '
+           << (entry.md5[1].empty() ? NO_MD5 : entry.md5[1]) << ' '
+           << file << '\n';
+    const std::string line(record.str());
+
+    std::FILE *out = std::fopen(m_path.c_str(), "ab");
+    if (!out)
+        return false;
+    std::setvbuf(out, nullptr, _IOFBF, line.length());
+    const bool ok = std::fwrite(line.data(), 1, line.length(), out) == line.length();
+    return (std::fclose(out) == 0) && ok;
+}
+
+bool Md5Cache::lookup(const std::string &file, bool newMD5, char *md5) {
+    if (!isOpen())
+        return false;
+
+    const std::string path(absolutePath(file));
+    uint64_t size;
+    int64_t  mtime;
+    if (!fileInfo(path, size, mtime))
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    map_t::const_iterator it = m_entries.find(path);
+    if ((it == m_entries.end()) || (it->second.size != size) || (it->second.mtime != mtime))
+        return false;
+
+    const std::string &value = it->second.md5[newMD5 ? 1 : 0];
+    if (value.empty())
+        return false;
+
+    memcpy(md5, value.c_str(), MD5_LENGTH + 1);
+    return true;
+}
+
+void Md5Cache::store(const std::string &file, bool newMD5, const char *md5) {
+    if (!isOpen() || !isMD5(md5))
+        return;
+
+    const std::string path(absolutePath(file));
+    uint64_t size;
+    int64_t  mtime;
+    if (!fileInfo(path, size, mtime))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    entry_t &entry = m_entries[path];
+    if ((entry.size != size) || (entry.mtime != mtime)) {
+        entry.size  = size;
+        entry.mtime = mtime;
+        entry.md5[0].clear();
+        entry.md5[1].clear();
+    }
+    entry.md5[newMD5 ? 1 : 0] = md5;
+
+    if (append(path, entry))
+        m_records++;
+}
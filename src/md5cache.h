@@ -0,0 +1,79 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef MD5CACHE_H
+#define MD5CACHE_H
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+#include <stdint.h>
+
+/*
+ * Persistent cache of tune MD5s, both the old and the new
+ * songlength DB flavour, keyed by path, size and mtime.
+ *
+ * The cache is a text log, one record per line, which is
+ * loaded at startup. New records are appended with a single
+ * write so that several processes can share the same file;
+ * on load later records override earlier ones and malformed
+ * lines, e.g. from an interrupted write, are ignored.
+ * It does not depend on libsidplayfp so any tool can use it.
+ */
+class Md5Cache {
+public:
+    static const unsigned int MD5_LENGTH = 32;
+
+private:
+    struct entry_t {
+        uint64_t size;
+        int64_t  mtime;
+        std::string md5[2]; // old, new
+    };
+
+    typedef std::unordered_map<std::string, entry_t> map_t;
+
+private:
+    std::string  m_path;
+    map_t        m_entries;
+    size_t       m_records; // lines in the file
+    std::mutex   m_lock;
+
+private:
+    static bool fileInfo(const std::string &file, uint64_t &size, int64_t &mtime);
+
+    bool append(const std::string &file, const entry_t &entry);
+    void compact();
+
+public:
+    Md5Cache() : m_records(0) {}
+
+    // Load the cache, the file is created on first store
+    bool open(const std::string &path);
+
+    bool isOpen() const { return !m_path.empty(); }
+
+    // Get the MD5 of a file, false if not cached or the file has changed
+    bool lookup(const std::string &file, bool newMD5, char *md5);
+
+    void store(const std::string &file, bool newMD5, const char *md5);
+};
+
+#endif // MD5CACHE_H
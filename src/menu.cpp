@@ -319,6 +319,32 @@ void ConsolePlayer::menu () {
 
     cerr << endl;
 
+    // Soundcard setup as negotiated with the driver
+    if (m_verboseLevel && ((m_driver.output == OUT_SOUNDCARD) || m_driver.monitor) && m_driver.cfg.periodSize) {
+        AudioConfig cfg;
+        m_driver.device->getConfig(cfg);
+
+        consoleTable (tableMiddle);
+        consoleColour(green, true);
+        cerr << " Audio device : ";
+        consoleColour(white, true);
+        cerr << cfg.device << ", " << cfg.periods << " x " << cfg.periodSize << " frames, "
+             << cfg.bufferTime / 1000 << '.' << (cfg.bufferTime / 100) % 10 << " ms" << endl;
+
+        // Known once something has been played
+        if (cfg.latency) {
+            const uint_least32_t latency = (uint_least32_t)(((uint_least64_t)cfg.latency * 10000) / cfg.frequency);
+            consoleTable (tableMiddle);
+            consoleColour(green, true);
+            cerr << " Latency      : ";
+            consoleColour(white, true);
+            cerr << latency / 10 << '.' << latency % 10 << " ms";
+            if (cfg.underruns)
+                cerr << ", " << cfg.underruns << " underrun" << ((cfg.underruns != 1) ? "s" : "");
+            cerr << endl;
+        }
+    }
+
     if (m_verboseLevel) {
         consoleTable(tableSeparator);
         consoleTable(tableMiddle);
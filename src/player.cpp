@@ -22,18 +22,28 @@
 
 #include "player.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <memory>
 #include <new>
 
 using std::cout;
 using std::cerr;
 using std::endl;
 
+// Interactive seek steps, ms
+const uint_least32_t SEEK_SHORT = 10 * 1000;
+const uint_least32_t SEEK_LONG  = 60 * 1000;
+
+// Seek progress shown after the time, " seeking NNN%"
+static const char SEEK_CLEAR[] = "             \b\b\b\b\b\b\b\b\b\b\b\b\b";
+static const char SEEK_BACK[]  = "\b\b\b\b\b\b\b\b\b\b\b\b\b";
+
 #include <stdlib.h>
 
 #ifdef HAVE_UNISTD_H
@@ -43,9 +53,13 @@ using std::endl;
 #include "utils.h"
 #include "keyboard.h"
 #include "audio/AudioDrv.h"
-#include "audio/au/auFile.h"
-#include "audio/wav/WavFile.h"
 #include "ini/types.h"
+#include "batch.h"
+#include "renderer.h"
+#include "segment.h"
+#include "stems.h"
+#include "spool.h"
+#include "looplength.h"
 
 #include "sidcxx11.h"
 
@@ -99,61 +113,6 @@ uint16_t freqTableNtsc[] {
 };
 #endif
 
-uint8_t* loadRom(const SID_STRING &romPath, const int size) {
-    SID_IFSTREAM is(romPath.c_str(), std::ios::binary);
-
-    if (is.is_open()) {
-        try {
-            uint8_t *buffer = new uint8_t[size];
-
-            is.read((char*)buffer, size);
-            if (!is.fail()) {
-                is.close();
-                return buffer;
-            }
-            delete [] buffer;
-        }
-        catch (std::bad_alloc const &ba) {}
-    }
-    return nullptr;
-}
-
-uint8_t* loadRom(const SID_STRING &romPath, const int size, const TCHAR defaultRom[]) {
-    // Try to load given rom
-    if (!romPath.empty()) {
-        uint8_t* buffer = loadRom(romPath, size);
-        if (buffer)
-            return buffer;
-    }
-
-    // Fallback to default rom path
-    try {
-#ifdef _WIN32
-        {
-            // Try exec dir first
-            SID_STRING execPath(utils::getExecPath());
-            execPath.append(SEPARATOR).append(defaultRom);
-            uint8_t* buffer = loadRom(execPath, size);
-            if (buffer)
-                return buffer;
-        }
-#endif
-        SID_STRING dataPath(utils::getDataPath());
-
-        dataPath.append(SEPARATOR).append(TEXT("sidplayfp")).append(SEPARATOR).append(defaultRom);
-#if !defined _WIN32 && defined HAVE_UNISTD_H
-        if (::access(dataPath.c_str(), R_OK) != 0) {
-            dataPath = PKGDATADIR;
-            dataPath.append(defaultRom);
-        }
-#endif
-        return loadRom(dataPath, size);
-    }
-    catch (utils::error const &e) {
-        return nullptr;
-    }
-}
-
 ConsolePlayer::ConsolePlayer (const char * const name) :
     m_name(name),
     m_tune(nullptr),
@@ -162,7 +121,12 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
     m_filename(""),
     m_quietLevel(0),
     m_cpudebug(false),
-    newSonglengthDB(false)
+    newSonglengthDB(false),
+    m_batchRenderer(nullptr),
+    m_segmentRenderer(nullptr),
+    m_stemRenderer(nullptr),
+    m_spoolWorker(nullptr),
+    m_lengthScanner(nullptr)
 {
 #ifdef FEAT_REGS_DUMP_SID
     memset(m_registers, 0, 32*3);
@@ -170,17 +134,38 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
     // Other defaults
     m_filter.enabled = true;
     m_driver.device  = NULL;
+    m_driver.queue   = nullptr;
+    m_driver.tee     = nullptr;
     m_driver.sid     = EMU_RESIDFP;
     m_timer.start    = 0;
     m_timer.length   = 0; // Infinite
     m_timer.valid    = false;
     m_timer.starting = false;
+    m_timer.warmup   = 1000;
+    m_timer.seeking  = false;
+    m_timer.progress = false;
+    m_timer.target   = 0;
+    m_timer.resume   = 0;
+    m_timer.resuming = false;
+    m_silence.enabled   = false;
+    m_silence.threshold = -60.;
+    m_silence.hold      = 5000;
+    m_silence.active    = false;
+    m_silence.ended     = false;
     m_track.first    = 0;
     m_track.selected = 0;
     m_track.loop     = false;
     m_track.single   = false;
     m_speed.current  = 1;
     m_speed.max      = 32;
+    m_batch.enabled  = false;
+    m_batch.threads  = 0;
+    m_batch.outDir   = ".";
+    m_batch.segments = 0;
+    m_batch.preroll  = 1000;
+    m_batch.stems    = false;
+    m_batch.stemsMix = false;
+    m_batch.leaseTime = 60;
 
     // Read default configuration
     m_iniCfg.read();
@@ -203,6 +188,11 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
         m_engCfg.fastSampling    = emulation.fastSampling;
         m_channels               = audio.channels;
         m_precision              = audio.precision;
+        m_driver.queueDepth      = (audio.queueDepth > 0) ? audio.queueDepth : 0;
+        m_driver.deviceName.assign(audio.device.begin(), audio.device.end());
+        m_driver.periodSize      = (audio.periodSize > 0) ? audio.periodSize : 0;
+        m_driver.periods         = (audio.periods > 0) ? audio.periods : 0;
+        m_driver.bufferTime      = (audio.bufferTime > 0) ? audio.bufferTime : 0;
         m_filter.enabled         = emulation.filter;
         m_filter.bias            = emulation.bias;
         m_filter.filterCurve6581 = emulation.filterCurve6581;
@@ -241,13 +231,32 @@ ConsolePlayer::ConsolePlayer (const char * const name) :
     createOutput(OUT_NULL, nullptr);
     createSidEmu(EMU_NONE);
 
-    uint8_t *kernalRom  = loadRom((m_iniCfg.sidplayfp()).kernalRom, 8192, TEXT("kernal"));
-    uint8_t *basicRom   = loadRom((m_iniCfg.sidplayfp()).basicRom, 8192, TEXT("basic"));
-    uint8_t *chargenRom = loadRom((m_iniCfg.sidplayfp()).chargenRom, 4096, TEXT("chargen"));
-    m_engine.setRoms(kernalRom, basicRom, chargenRom);
-    delete [] kernalRom;
-    delete [] basicRom;
-    delete [] chargenRom;
+    // The ROMs are mapped once, batch renderers use them too
+    m_roms.load(RomCache::KERNAL, (m_iniCfg.sidplayfp()).kernalRom);
+    m_roms.load(RomCache::BASIC, (m_iniCfg.sidplayfp()).basicRom);
+    m_roms.load(RomCache::CHARGEN, (m_iniCfg.sidplayfp()).chargenRom);
+    m_engine.setRoms(m_roms.get(RomCache::KERNAL), m_roms.get(RomCache::BASIC), m_roms.get(RomCache::CHARGEN));
+
+    if (m_verboseLevel > 1) {
+        const char *names[RomCache::ROMS] = { "kernal", "basic", "chargen" };
+        for (int i = 0; i < RomCache::ROMS; i++) {
+            const RomCache::rom_t rom = (RomCache::rom_t) i;
+            if (m_roms.get(rom) && !m_roms.identify(rom))
+                cerr << "WARNING: unknown " << names[i] << " ROM image, CRC32 " << std::hex << m_roms.crc(rom) << std::dec << endl;
+        }
+    }
+}
+
+// Get the length of a song from the songlength DB in ms, -1 if not found
+int_least32_t ConsolePlayer::songLength(const char *md5, unsigned int song) {
+    if (m_songlengths.isOpen())
+        return m_songlengths.lengthMs(md5, song);
+#ifdef FEAT_NEW_SONLEGTH_DB
+    if (newSonglengthDB)
+        return m_database.lengthMs(md5, song);
+#endif
+    const int_least32_t length = m_database.length(md5, song);
+    return (length > 0) ? length * 1000 : -1;
 }
 
 std::string ConsolePlayer::getFileName(const SidTuneInfo *tuneInfo, const char* ext) {
@@ -275,8 +284,19 @@ std::string ConsolePlayer::getFileName(const SidTuneInfo *tuneInfo, const char*
     return title;
 }
 
+// Soundcard driver, behind the output thread if enabled
+IAudio* ConsolePlayer::createSoundcard() {
+    std::unique_ptr<IAudio> device(new audioDrv());
+    if (!m_driver.queueDepth)
+        return device.release();
+
+    m_driver.queue = new Audio_Queue(device.get(), m_driver.queueDepth);
+    device.release();
+    return m_driver.queue;
+}
+
 // Create the output object to process sound buffer
-bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
+bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo, uint_least32_t length) {
     // Remove old audio driver
     m_driver.null.close ();
     m_driver.selected = &m_driver.null;
@@ -284,6 +304,8 @@ bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
         if (m_driver.device != &m_driver.null)
             delete m_driver.device;
         m_driver.device = nullptr;
+        m_driver.queue  = nullptr;
+        m_driver.tee    = nullptr;
     }
     // Create audio driver
     switch (driver) {
@@ -293,7 +315,7 @@ bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
 
     case OUT_SOUNDCARD:
         try {
-            m_driver.device = new audioDrv();
+            m_driver.device = createSoundcard();
         }
         catch (std::bad_alloc const &ba) {
             m_driver.device = nullptr;
@@ -301,31 +323,48 @@ bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
     break;
 
     case OUT_WAV:
+    case OUT_AU:
+    case OUT_RAW:
+#ifdef HAVE_FLAC
+    case OUT_FLAC:
+#endif
+#ifdef HAVE_OPUSENC
+    case OUT_OPUS:
+#endif
         try {
-            std::string title = getFileName(tuneInfo, WavFile::extension());
-            WavFile* wav = new WavFile(title);
-            if (m_driver.info && (tuneInfo->numberOfInfoStrings() == 3))
-                wav->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
-            m_driver.device = wav;
+            const std::string title = getFileName(tuneInfo, outputExtension(driver));
+            // Written at other sample rates too if asked for
+            m_driver.device = createRateOutputs(createFileOutput(driver, title, tuneInfo, m_driver.info, m_driver.loudness),
+                                                driver, title, tuneInfo, m_driver.info, m_driver.loudness, m_driver.rates);
         }
         catch (std::bad_alloc const &ba) {
             m_driver.device = nullptr;
         }
     break;
 
-    case OUT_AU:
+    default:
+        break;
+    }
+
+    // Play on the soundcard while the file is written in the background
+    if (m_driver.monitor && (driver > OUT_SOUNDCARD) && m_driver.device) {
+        std::unique_ptr<IAudio> file(m_driver.device);
+        m_driver.device = nullptr;
         try {
-            std::string title = getFileName(tuneInfo, auFile::extension());
-            m_driver.device = new auFile(title);
+            std::unique_ptr<IAudio> soundcard(createSoundcard());
+            m_driver.tee = new Audio_Tee(soundcard.get());
+            soundcard.release();
+            m_driver.device = m_driver.tee;
+            m_driver.tee->add(file.release());
         }
         catch (std::bad_alloc const &ba) {
+            delete m_driver.tee;
             m_driver.device = nullptr;
+            m_driver.queue  = nullptr;
+            m_driver.tee    = nullptr;
         }
-    break;
-
-    default:
-        break;
     }
+
     // Audio driver failed
     if (!m_driver.device) {
         m_driver.device = &m_driver.null;
@@ -334,12 +373,19 @@ bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
     }
 
     int tuneChannels = (tuneInfo && (tuneInfo->sidChips() > 1)) ? 2 : 1;
+    if (m_driver.multichannel && tuneInfo)
+        tuneChannels = tuneInfo->sidChips();
 
     // Configure with user settings
     m_driver.cfg.frequency = m_engCfg.frequency;
-    m_driver.cfg.channels  = m_channels ? m_channels : tuneChannels;
+    m_driver.cfg.channels  = (m_channels && !m_driver.multichannel) ? m_channels : tuneChannels;
     m_driver.cfg.precision = m_precision;
     m_driver.cfg.bufSize   = 0; // Recalculate
+    m_driver.cfg.length    = length;
+    m_driver.cfg.device     = m_driver.deviceName;
+    m_driver.cfg.periodSize = m_driver.periodSize;
+    m_driver.cfg.periods    = m_driver.periods;
+    m_driver.cfg.bufferTime = m_driver.bufferTime * 1000;
 
     {   // Open the hardware
         bool err = false;
@@ -367,7 +413,10 @@ bool ConsolePlayer::createOutput (OUTPUTS driver, const SidTuneInfo *tuneInfo) {
         m_engCfg.playback = SidConfig::STEREO;
         break;
     default:
-        cerr << m_name << ": " << "ERROR: " << m_channels << " channels unsupported!" << endl;
+        // One engine per chip, see renderChannels
+        if (m_driver.multichannel && ((int)m_driver.cfg.channels == tuneChannels))
+            break;
+        cerr << m_name << ": " << "ERROR: " << m_driver.cfg.channels << " channels unsupported!" << endl;
         return false;
     }
     return true;
@@ -499,11 +548,35 @@ bool ConsolePlayer::open (void) {
     const SidTuneInfo *tuneInfo = m_tune.getInfo();
     if (!m_track.single)
         m_track.songs = tuneInfo->songs();
-    if (!createOutput(m_driver.output, tuneInfo))
-        return false;
+
+    // As yet we don't have a required songlength
+    // so try the songlength database or keep the default
+    bool lengthKnown = m_timer.valid;
+    if (!m_timer.valid) {
+        char md5[SidTune::MD5_LENGTH + 1];
+        tuneMD5(m_tune, m_filename, newSonglengthDB, m_md5Cache.isOpen() ? &m_md5Cache : nullptr, md5);
+        const int_least32_t length = songLength(md5, tuneInfo->currentSong());
+        if (length > 0) {
+            m_timer.length = length;
+            lengthKnown = true;
+        }
+    }
+
+    {   // Expected output length, lets file output reserve disk space
+        uint_least32_t length = m_timer.length;
+        if (!m_timer.valid)
+            length = (length > m_timer.start) ? length - m_timer.start : 0;
+        if (!createOutput(m_driver.output, tuneInfo, length))
+            return false;
+    }
     if (!createSidEmu(m_driver.sid))
         return false;
 
+    // Only the default length is cut short
+    m_silence.ended  = false;
+    m_silence.active = m_silence.enabled && !lengthKnown
+        && m_silence.detector.setup(m_driver.cfg.frequency, m_driver.cfg.channels, m_silence.threshold, m_silence.hold);
+
     // Configure engine with settings
     if (!m_engine.config(m_engCfg)) { // Config failed
         displayError(m_engine.error());
@@ -528,17 +601,14 @@ bool ConsolePlayer::open (void) {
     m_engine.mute(2, 1, vMute[7]);
     m_engine.mute(2, 2, vMute[8]);
 
-    // As yet we don't have a required songlength
-    // so try the songlength database or keep the default
-    if (!m_timer.valid) {
-#ifdef FEAT_NEW_SONLEGTH_DB
-        const int_least32_t length = newSonglengthDB ? m_database.lengthMs(m_tune) : (m_database.length(m_tune) * 1000);
-#else
-        const int_least32_t length = m_database.length(m_tune) * 1000;
-#endif
-        if (length > 0)
-            m_timer.length = length;
-    }
+    // Pre-roll without the filter up to the warm-up
+    // window, as in Renderer::seek()
+    m_timer.target   = m_timer.resuming ? m_timer.resume : m_timer.start;
+    m_timer.resuming = false;
+    m_timer.seeking  = m_filter.enabled && m_engCfg.sidEmulation && (m_timer.target > m_timer.warmup)
+        && ((m_driver.sid == EMU_RESIDFP) || (m_driver.sid == EMU_RESID));
+    if (m_timer.seeking)
+        m_engCfg.sidEmulation->filter(false);
 
     // Set up the play timer
     m_timer.stop = m_timer.length;
@@ -577,6 +647,21 @@ void ConsolePlayer::close() {
 	    cerr << '\x1b' << "[?25h";
         m_driver.selected->reset ();
 
+    if (m_driver.queue && (m_verboseLevel > 1)) {
+        cerr << "Audio queue: " << m_driver.queue->depth() << " blocks, lowest fill "
+             << m_driver.queue->minFill() << ", ran empty " << m_driver.queue->emptyCount() << " times" << endl;
+    }
+
+    if (m_driver.tee) {
+        // Finish the recording, playback errors don't matter anymore
+        m_driver.tee->close();
+        if (m_driver.tee->failed())
+            displayError(m_driver.tee->getErrorString());
+        else if (m_driver.tee->dropped())
+            cerr << "WARNING: the file output fell behind, " << m_driver.tee->dropped()
+                 << " blocks are missing from the recording" << endl;
+    }
+
     // Shutdown drivers, etc
     createOutput   (OUT_NULL, nullptr);
     createSidEmu   (EMU_NONE);
@@ -626,6 +711,10 @@ bool ConsolePlayer::play() {
             }
             return false;
         }
+
+        // The end is checked on what is actually output
+        if (m_silence.active && !m_silence.ended && !m_timer.starting)
+            m_silence.ended = m_silence.detector.process(buffer, retSize / m_driver.cfg.channels);
     }
     switch (m_state) {
     case playerRunning:
@@ -649,11 +738,8 @@ bool ConsolePlayer::play() {
 #elif HAVE_TSID == 2
         if (m_tsid) {
             char md5[SidTune::MD5_LENGTH + 1];
-            if (newSonglengthDB)
-                m_tune.createMD5New(md5);
-            else
-                m_tune.createMD5(md5);
-            int_least32_t length = m_database.lengthMs(md5, m_track.selected);
+            tuneMD5(m_tune, m_filename, newSonglengthDB, m_md5Cache.isOpen() ? &m_md5Cache : nullptr, md5);
+            int_least32_t length = songLength(md5, m_track.selected);
             // ignore errors
             if (length < 0)
                 length = 0;
@@ -669,11 +755,79 @@ bool ConsolePlayer::play() {
 void ConsolePlayer::stop() {
     m_state = playerStopped;
     m_engine.stop ();
+    if (m_batchRenderer)
+        m_batchRenderer->stop();
+    if (m_segmentRenderer)
+        m_segmentRenderer->stop();
+    if (m_stemRenderer)
+        m_stemRenderer->stop();
+    if (m_spoolWorker)
+        m_spoolWorker->stop();
+    if (m_lengthScanner)
+        m_lengthScanner->stop();
+}
+
+// Jump by an offset in ms from the current position. The engine
+// state cannot be saved and restored, so jumping back restarts the
+// song; either way the fast pre-roll runs up to the new position
+void ConsolePlayer::seek(int_least32_t offset) {
+    // A recording would get a hole in it
+    if ((m_driver.output != OUT_SOUNDCARD) || m_driver.monitor)
+        return;
+
+    const uint_least32_t position = m_timer.starting ? m_timer.target : m_timer.current;
+
+    if (offset < 0) {
+        const uint_least32_t back = -offset;
+        m_timer.resume   = (position > back) ? position - back : 0;
+        m_timer.resuming = true;
+        m_state = playerFastRestart;
+        return;
+    }
+
+    if (!m_timer.starting) {
+        m_driver.selected->reset();
+        m_driver.selected = &m_driver.null;
+        m_timer.starting  = true;
+    }
+    m_timer.target  = position + offset;
+    m_speed.current = m_speed.max;
+    m_engine.fastForward(100 * m_speed.current);
+
+    if (!m_timer.seeking && m_filter.enabled && m_engCfg.sidEmulation
+        && (m_timer.target - m_timer.current > m_timer.warmup)
+        && ((m_driver.sid == EMU_RESIDFP) || (m_driver.sid == EMU_RESID))) {
+        m_timer.seeking = true;
+        m_engCfg.sidEmulation->filter(false);
+    }
+
+    // Silence is counted from the new position
+    m_silence.detector.reset();
 }
 
 uint_least32_t ConsolePlayer::getBufSize() {
-    if (m_timer.starting && (m_timer.current >= m_timer.start)) { // Switch audio drivers.
+    if (m_timer.seeking) {
+        const uint_least32_t warmup = m_timer.target - m_timer.warmup;
+        if (m_timer.current >= warmup) {
+            m_timer.seeking = false;
+            m_engCfg.sidEmulation->filter(m_filter.enabled);
+        }
+        else {
+            // Stop at the warm-up, output is decimated by the speed
+            const uint_least64_t frames = (uint_least64_t)(warmup - m_timer.current) * m_driver.cfg.frequency
+                / (1000 * m_speed.current) + 1;
+            if (frames * m_driver.cfg.channels < m_driver.cfg.bufSize)
+                return frames * m_driver.cfg.channels;
+            return m_driver.cfg.bufSize;
+        }
+    }
+
+    if (m_timer.starting && (m_timer.current >= m_timer.target)) { // Switch audio drivers.
         m_timer.starting = false;
+        if (m_timer.progress) { // Clear the seek progress
+            cerr << SEEK_CLEAR << std::flush;
+            m_timer.progress = false;
+        }
         m_driver.selected = m_driver.device;
         memset(m_driver.selected->buffer (), 0, m_driver.cfg.bufSize);
         m_speed.current = 1;
@@ -681,7 +835,15 @@ uint_least32_t ConsolePlayer::getBufSize() {
         if (m_cpudebug)
             m_engine.debug (true, nullptr);
     }
-    else if ((m_timer.stop != 0) && (m_timer.current >= m_timer.stop)) {
+    else if (m_silence.ended || ((m_timer.stop != 0) && (m_timer.current >= m_timer.stop))) {
+        if (m_silence.ended && (m_quietLevel < 2)) {
+            // Where the silence began, the hold time is kept in the output
+            const uint_least32_t end = m_timer.target
+                + (uint_least32_t)(m_silence.detector.endFrame() * 1000 / m_driver.cfg.frequency);
+            cerr << endl << "End of music detected at " << (end / 60000) << ':'
+                 << std::setw(2) << std::setfill('0') << ((end / 1000) % 60) << '.'
+                 << std::setw(3) << (end % 1000) << std::setfill(' ');
+        }
         m_state = playerExit;
         for (;;) {
             if (m_track.single)
@@ -724,7 +886,15 @@ void ConsolePlayer::updateDisplay() {
             cerr << "\b\b\b\b\b";
         cerr << std::setw(2) << std::setfill('0')
              << ((seconds / 60) % 100) << ':' << std::setw(2)
-             << std::setfill('0') << (seconds % 60) << std::flush;
+             << std::setfill('0') << (seconds % 60);
+        // Pre-roll progress after the time, the cursor stays before it
+        if (m_timer.starting && m_timer.target && (m_verboseLevel < 2)) {
+            cerr << " seeking " << std::setw(3) << std::setfill(' ')
+                 << std::min<uint_least32_t>(milliseconds / (m_timer.target / 100 + 1), 99) << '%'
+                 << SEEK_BACK;
+            m_timer.progress = true;
+        }
+        cerr << std::flush;
     }
     m_timer.current = milliseconds;
 }
@@ -763,6 +933,22 @@ void ConsolePlayer::decodeKeys() {
             m_state = playerFastRestart;
         break;
 
+        case A_SEEK_BACK:
+            seek(-(int_least32_t)SEEK_SHORT);
+        break;
+
+        case A_SEEK_FORWARD:
+            seek(SEEK_SHORT);
+        break;
+
+        case A_SEEK_BACK_LONG:
+            seek(-(int_least32_t)SEEK_LONG);
+        break;
+
+        case A_SEEK_FORWARD_LONG:
+            seek(SEEK_LONG);
+        break;
+
         case A_UP_ARROW:     
             m_speed.current *= 2;
             if (m_speed.current > m_speed.max)
@@ -28,6 +28,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 #include <sidplayfp/SidTune.h>
 #include <sidplayfp/sidplayfp.h>
@@ -37,8 +38,14 @@
 
 #include "audio/IAudio.h"
 #include "audio/AudioConfig.h"
+#include "audio/SilenceDetector.h"
 #include "audio/null/null.h"
+#include "audio/queue/queue.h"
+#include "audio/tee/tee.h"
 #include "IniConfig.h"
+#include "songlength.h"
+#include "md5cache.h"
+#include "romcache.h"
 
 #include "sidlib_features.h"
 
@@ -78,7 +85,7 @@ typedef enum {
     /* Hardware */
     OUT_SOUNDCARD,
     /* File creation support */
-    OUT_WAV, OUT_AU, OUT_END
+    OUT_WAV, OUT_AU, OUT_RAW, OUT_FLAC, OUT_OPUS, OUT_END
 } OUTPUTS;
 
 // Error and status message numbers.
@@ -91,6 +98,13 @@ enum {
 
 void displayError (const char *arg0, unsigned int num);
 
+class BatchRenderer;
+class SegmentRenderer;
+class StemRenderer;
+class SpoolWorker;
+class LengthScanner;
+struct renderSettings;
+
 // Grouped global variables
 class ConsolePlayer {
 private:
@@ -120,6 +134,8 @@ private:
 
     IniConfig         m_iniCfg;
     SidDatabase       m_database;
+    SonglengthIndex   m_songlengths;
+    Md5Cache          m_md5Cache;
 
     uint8_t           m_registers[3][32];
     uint16_t*         m_freqTable;
@@ -152,10 +168,21 @@ private:
         SIDEMUS     sid;      // SID emulation
         bool        file;     // File based driver
         bool        info;     // File metadata
+        bool        loudness; // Measure file loudness
+        bool        monitor;  // Play file output on the soundcard too
+        bool        multichannel; // One channel per SID chip
+        std::vector<unsigned int> rates; // Extra file sample rates
         AudioConfig cfg;
         IAudio*     selected; // Selected output driver
         IAudio*     device;   // HW/File Driver
         Audio_Null  null;     // anything else
+        Audio_Queue* queue;   // output thread in front of the soundcard
+        Audio_Tee*   tee;     // soundcard and file output
+        unsigned int queueDepth;
+        std::string    deviceName; // soundcard settings, empty or 0 for default
+        uint_least32_t periodSize; // frames
+        unsigned int   periods;
+        uint_least32_t bufferTime; // ms
     } m_driver;
 
     struct m_timer_t { // secs
@@ -165,8 +192,23 @@ private:
         uint_least32_t length;
         bool           valid;
         bool           starting;
+        uint_least32_t warmup;   // full synthesis before the start
+        bool           seeking;  // filter off in the pre-roll
+        bool           progress; // seek progress shown
+        uint_least32_t target;   // end of the pre-roll, start or seek position
+        uint_least32_t resume;   // seek position after a restart
+        bool           resuming;
     } m_timer;
 
+    struct m_silence_t { // End of music detection
+        bool            enabled;
+        double          threshold; // dBFS
+        uint_least32_t  hold;      // ms
+        bool            active;    // song length not known
+        bool            ended;
+        SilenceDetector detector;
+    } m_silence;
+
     struct m_track_t {
         uint_least16_t first;
         uint_least16_t selected;
@@ -181,6 +223,28 @@ private:
         uint_least8_t max;
     } m_speed;
 
+    struct m_batch_t {
+        bool                     enabled;
+        unsigned int             threads; // 0 = one per core
+        std::string              outDir;
+        std::vector<std::string> inputs;
+        unsigned int             segments; // split songs for parallel rendering
+        uint_least32_t           preroll;  // ms
+        bool                     stems;    // one file per voice
+        bool                     stemsMix; // and the full mix
+        std::string              spool;    // shared job queue directory
+        uint_least32_t           leaseTime; // seconds
+        std::string              lengthFile; // songlength DB written by the scan
+    } m_batch;
+
+    BatchRenderer   *m_batchRenderer;
+    SegmentRenderer *m_segmentRenderer;
+    StemRenderer    *m_stemRenderer;
+    SpoolWorker     *m_spoolWorker;
+    LengthScanner   *m_lengthScanner;
+
+    RomCache m_roms;
+
 private:
     // Console
     void consoleColour (player_colour_t colour, bool bold);
@@ -190,11 +254,13 @@ private:
     // Command line args
     void displayArgs   (const char *arg = NULL);
 
-    bool createOutput  (OUTPUTS driver, const SidTuneInfo *tuneInfo);
+    IAudio* createSoundcard();
+    bool createOutput  (OUTPUTS driver, const SidTuneInfo *tuneInfo, uint_least32_t length = 0);
     bool createSidEmu  (SIDEMUS emu);
     void displayError  (const char *error);
     void displayError  (unsigned int num) { ::displayError (m_name, num); }
     void decodeKeys    (void);
+    void seek          (int_least32_t offset);
     void updateDisplay ();
     void emuflush      (void);
     void menu          (void);
@@ -208,6 +274,11 @@ private:
 
     inline bool tryOpenTune(const char *hvscBase);
     inline bool tryOpenDatabase(const char *hvscBase, const char *suffix);
+    bool openDatabase(const char *database);
+
+    int_least32_t songLength(const char *md5, unsigned int song);
+
+    void renderConfig(renderSettings &settings);
 
 public:
     ConsolePlayer (const char * const name);
@@ -218,6 +289,19 @@ public:
     void close(void);
     bool play (void);
     void stop (void);
+    bool batch(void);
+    bool renderSegments(void);
+    bool renderStems(void);
+    bool renderChannels(void);
+    bool spool(void);
+    bool findLengths(void);
+
+    bool batchMode() const { return m_batch.enabled; }
+    bool spoolMode() const { return !m_batch.spool.empty(); }
+    bool lengthMode() const { return !m_batch.lengthFile.empty(); }
+    bool segmentMode() const { return !m_batch.enabled && (m_batch.segments > 1); }
+    bool stemMode() const { return !m_batch.enabled && m_batch.stems; }
+    bool channelMode() const { return !m_batch.enabled && m_driver.multichannel && (m_tune.getInfo()->sidChips() > 2); }
 
     player_state_t state (void) const { return m_state; }
 };
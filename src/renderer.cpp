@@ -0,0 +1,543 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "renderer.h"
+
+#include <memory>
+#include <sstream>
+#include <new>
+
+#include "audio/IAudio.h"
+#include "audio/AudioConfig.h"
+#include "audio/SilenceDetector.h"
+#include "audio/au/auFile.h"
+#include "audio/wav/WavFile.h"
+#include "audio/raw/RawFile.h"
+#include "audio/flac/FlacFile.h"
+#include "audio/opus/OpusFile.h"
+#include "audio/queue/queue.h"
+#include "audio/rates/rates.h"
+#include "audio/loudness/loudness.h"
+
+#include "sidcxx11.h"
+
+#include <sidplayfp/sidbuilder.h>
+
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+#  include <sidplayfp/builders/residfp.h>
+#endif
+
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESID_H
+#  include <sidplayfp/builders/resid.h>
+#endif
+
+Renderer::Renderer(const renderSettings &settings, const std::atomic<bool> &abort) :
+    m_settings(settings),
+    m_abort(abort),
+    m_tune(nullptr),
+    m_channels(1),
+    m_finished(false),
+    m_endTime(0)
+{
+    for (int i = 0; i < 9; i++)
+        m_mute[i] = settings.mute[i];
+
+    m_engCfg = settings.engCfg;
+    m_engCfg.sidEmulation = nullptr;
+
+    m_engine.setRoms(settings.kernalRom, settings.basicRom, settings.chargenRom);
+
+    createSidEmu();
+}
+
+Renderer::~Renderer() {
+    m_engine.load(nullptr);
+    if (m_engCfg.sidEmulation) {
+        sidbuilder *builder   = m_engCfg.sidEmulation;
+        m_engCfg.sidEmulation = nullptr;
+        m_engine.config(m_engCfg);
+        delete builder;
+    }
+}
+
+// Create the sid emulation, only software emulations
+// can be used for rendering
+bool Renderer::createSidEmu() {
+    switch (m_settings.sid) {
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+    case EMU_RESIDFP: {
+        try {
+            ReSIDfpBuilder *rs = new ReSIDfpBuilder("ReSIDfp");
+
+            m_engCfg.sidEmulation = rs;
+            if (!rs->getStatus()) goto createSidEmu_error;
+            rs->create ((m_engine.info ()).maxsids());
+            if (!rs->getStatus()) goto createSidEmu_error;
+
+            if (m_settings.filterCurve6581)
+                rs->filter6581Curve(m_settings.filterCurve6581);
+            if (m_settings.filterCurve8580)
+                rs->filter8580Curve(m_settings.filterCurve8580);
+        }
+        catch (std::bad_alloc const &ba) {}
+        break;
+    }
+#endif // HAVE_SIDPLAYFP_BUILDERS_RESIDFP_H
+
+#ifdef HAVE_SIDPLAYFP_BUILDERS_RESID_H
+    case EMU_RESID: {
+        try {
+            ReSIDBuilder *rs = new ReSIDBuilder("ReSID");
+
+            m_engCfg.sidEmulation = rs;
+            if (!rs->getStatus()) goto createSidEmu_error;
+            rs->create ((m_engine.info ()).maxsids());
+            if (!rs->getStatus()) goto createSidEmu_error;
+
+            rs->bias(m_settings.bias);
+        }
+        catch (std::bad_alloc const &ba) {}
+        break;
+    }
+#endif // HAVE_SIDPLAYFP_BUILDERS_RESID_H
+
+    case EMU_NONE:
+        return true;
+
+    default:
+        setError("ERROR: cannot render using hardware emulations");
+        return false;
+    }
+
+    if (!m_engCfg.sidEmulation) {
+        setError("ERROR: not enough memory.");
+        return false;
+    }
+
+    m_engCfg.sidEmulation->filter(m_settings.filter);
+    return true;
+
+createSidEmu_error:
+    setError(m_engCfg.sidEmulation->error());
+    delete m_engCfg.sidEmulation;
+    m_engCfg.sidEmulation = nullptr;
+    return false;
+}
+
+const char *outputExtension(OUTPUTS output) {
+    switch (output) {
+    case OUT_AU:
+        return auFile::extension();
+    case OUT_RAW:
+        return RawFile::extension();
+#ifdef HAVE_FLAC
+    case OUT_FLAC:
+        return FlacFile::extension();
+#endif
+#ifdef HAVE_OPUSENC
+    case OUT_OPUS:
+        return OpusFile::extension();
+#endif
+    case OUT_WAV:
+    default:
+        return WavFile::extension();
+    }
+}
+
+IAudio *createFileOutput(OUTPUTS output, const std::string &name, const SidTuneInfo *tuneInfo, bool info, bool loudness) {
+    info = info && (tuneInfo->numberOfInfoStrings() == 3);
+
+    std::unique_ptr<IAudio> sink;
+    WavFile *wav = nullptr;
+#ifdef HAVE_FLAC
+    FlacFile *flac = nullptr;
+#endif
+
+    switch (output) {
+    case OUT_AU:
+        sink.reset(new auFile(name));
+        break;
+
+    case OUT_RAW:
+        sink.reset(new RawFile(name));
+        break;
+
+#ifdef HAVE_FLAC
+    case OUT_FLAC: {
+        std::unique_ptr<FlacFile> file(new FlacFile(name));
+        if (info)
+            file->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
+        // Encode on the queue thread
+        sink.reset(new Audio_Queue(file.get(), Audio_Queue::ENCODER_DEPTH, true));
+        flac = file.release();
+        break;
+    }
+#endif
+
+#ifdef HAVE_OPUSENC
+    case OUT_OPUS: {
+        std::unique_ptr<OpusFile> file(new OpusFile(name));
+        if (info)
+            file->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
+        // Encode on the queue thread
+        sink.reset(new Audio_Queue(file.get(), Audio_Queue::ENCODER_DEPTH, true));
+        file.release();
+        break;
+    }
+#endif
+
+    case OUT_WAV:
+    default:
+        wav = new WavFile(name);
+        sink.reset(wav);
+        if (info)
+            wav->setInfo(tuneInfo->infoString(0), tuneInfo->infoString(1), tuneInfo->infoString(2));
+        break;
+    }
+
+    if (!loudness)
+        return sink.release();
+
+    Audio_Loudness *meter = new Audio_Loudness(sink.get(), name);
+    sink.release();
+    if (wav)
+        wav->setLoudness(&meter->meter());
+#ifdef HAVE_FLAC
+    if (flac)
+        flac->setLoudness(&meter->meter());
+#endif
+    return meter;
+}
+
+// Insert the rate before the extension
+static std::string rateFileName(const std::string &name, unsigned int rate) {
+    std::ostringstream sstream;
+    sstream << '.' << rate;
+
+    std::string rateName(name);
+    const size_t dot = name.find_last_of('.');
+    const size_t slash = name.find_last_of("/\\");
+    if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash)))
+        rateName.append(sstream.str());
+    else
+        rateName.insert(dot, sstream.str());
+    return rateName;
+}
+
+IAudio *createRateOutputs(IAudio *sink, OUTPUTS output, const std::string &name, const SidTuneInfo *tuneInfo,
+                          bool info, bool loudness, const std::vector<unsigned int> &rates) {
+    std::unique_ptr<IAudio> main(sink);
+    if (rates.empty())
+        return main.release();
+
+    std::unique_ptr<Audio_Rates> outputs(new Audio_Rates(main.get()));
+    main.release();
+    for (std::vector<unsigned int>::const_iterator it = rates.begin(); it != rates.end(); ++it)
+        outputs->add(createFileOutput(output, rateFileName(name, *it), tuneInfo, info, loudness), *it);
+    return outputs.release();
+}
+
+IAudio *Renderer::createOutput(const SidTuneInfo *tuneInfo, const std::string &name) {
+    try {
+        const std::string fileName(name + outputExtension(m_settings.output));
+        return createRateOutputs(createFileOutput(m_settings.output, fileName, tuneInfo, m_settings.info, m_settings.loudness),
+                                 m_settings.output, fileName, tuneInfo, m_settings.info, m_settings.loudness,
+                                 m_settings.rates);
+    }
+    catch (std::bad_alloc const &ba) {
+        setError("ERROR: not enough memory.");
+        return nullptr;
+    }
+}
+
+void tuneMD5(SidTune &tune, const std::string &file, bool newSonglengthDB, Md5Cache *cache, char *md5) {
+    if (cache && cache->lookup(file, newSonglengthDB, md5))
+        return;
+
+#ifdef FEAT_NEW_SONLEGTH_DB
+    if (newSonglengthDB)
+        tune.createMD5New(md5);
+    else
+#endif
+        tune.createMD5(md5);
+
+    if (cache)
+        cache->store(file, newSonglengthDB, md5);
+}
+
+int_least32_t renderSettings::songLength(const char *md5, unsigned int song) const {
+    // The index is read-only, no locking needed
+    if (songlengths)
+        return songlengths->lengthMs(md5, song);
+
+    if (!database)
+        return -1;
+
+    std::lock_guard<std::mutex> lock(databaseLock);
+#ifdef FEAT_NEW_SONLEGTH_DB
+    if (newSonglengthDB)
+        return database->lengthMs(md5, song);
+#endif
+    const int_least32_t length = database->length(md5, song);
+    return (length > 0) ? length * 1000 : -1;
+}
+
+uint_least32_t renderSettings::stopTime(int_least32_t dbLength) const {
+    if (lengthValid) // Length relative to start
+        return start + length;
+
+    const uint_least32_t stop = (dbLength > 0) ? dbLength : defaultLength;
+    return (start < stop) ? stop : 0;
+}
+
+uint_least32_t Renderer::timeMs() const {
+#ifdef FEAT_NEW_SONLEGTH_DB
+    return m_engine.timeMs();
+#else
+    return m_engine.time() * 1000;
+#endif
+}
+
+bool Renderer::sidStatus(unsigned int chip, uint8_t regs[32]) {
+#ifdef FEAT_REGS_DUMP_SID
+    return m_engine.getSidStatus(chip, regs);
+#else
+    (void) chip;
+    (void) regs;
+    return false;
+#endif
+}
+
+bool Renderer::loadTune(SidTune &tune, const std::string &filename, const char *hvscBase) {
+    tune.load(filename.c_str());
+    if (tune.getStatus())
+        return true;
+
+    // Try prepending HVSC_BASE
+    if (!hvscBase)
+        return false;
+
+    std::string newFileName(hvscBase);
+    newFileName.append("/").append(filename);
+    tune.load(newFileName.c_str());
+    return tune.getStatus();
+}
+
+bool Renderer::load(const std::string &filename) {
+    if (filename == m_filename)
+        return true;
+
+    m_filename.clear();
+    if (!loadTune(m_tune, filename, m_settings.hvscBase)) {
+        setError(m_tune.statusString());
+        return false;
+    }
+
+    m_filename = filename;
+    return true;
+}
+
+bool Renderer::setup(unsigned int song) {
+    if (m_settings.sid != EMU_NONE && !m_engCfg.sidEmulation)
+        return false;
+
+    m_tune.selectSong(song);
+    if (!m_engine.load(&m_tune)) {
+        setError(m_engine.error());
+        return false;
+    }
+
+    m_finished = false;
+    return true;
+}
+
+bool Renderer::configure(const AudioConfig &cfg) {
+    m_engCfg.frequency = cfg.frequency;
+    switch (cfg.channels) {
+    case 1:
+        m_engCfg.playback = SidConfig::MONO;
+        break;
+    case 2:
+        m_engCfg.playback = SidConfig::STEREO;
+        break;
+    default:
+        setError("ERROR: unsupported number of channels");
+        return false;
+    }
+
+    if (!m_engine.config(m_engCfg)) {
+        setError(m_engine.error());
+        return false;
+    }
+
+    for (unsigned int i = 0; i < 9; i++)
+        m_engine.mute(i / 3, i % 3, m_mute[i]);
+
+    m_channels = cfg.channels;
+    return true;
+}
+
+bool Renderer::seek(uint_least32_t time, short *buffer, uint_least32_t size) {
+    const unsigned int speed = 32;
+
+    // The filter is the costliest part of the emulation and
+    // only its integrators carry state over, which is rebuilt
+    // within the warm-up window: leave it out until then
+    const uint_least32_t warmup = (time > m_settings.warmup) ? time - m_settings.warmup : 0;
+    bool filterOff = warmup && m_settings.filter && m_engCfg.sidEmulation;
+    if (filterOff)
+        m_engCfg.sidEmulation->filter(false);
+
+    m_engine.fastForward(100 * speed);
+    while (timeMs() < time) {
+        if (m_abort) {
+            setError("Aborted");
+            break;
+        }
+
+        uint_least32_t length = size;
+        if (filterOff) {
+            const uint_least32_t current = timeMs();
+            if (current >= warmup) {
+                m_engCfg.sidEmulation->filter(true);
+                filterOff = false;
+            }
+            else { // Stop at the warm-up, output is decimated by the speed
+                const uint_least64_t frames = (uint_least64_t)(warmup - current) * m_engCfg.frequency / (1000 * speed) + 1;
+                if (frames * m_channels < length)
+                    length = frames * m_channels;
+            }
+        }
+
+        if (m_engine.play(buffer, length) < length) {
+            setError(m_engine.error());
+            break;
+        }
+    }
+
+    if (filterOff)
+        m_engCfg.sidEmulation->filter(true);
+    m_engine.fastForward(100);
+    return timeMs() >= time;
+}
+
+bool Renderer::play(short *buffer, uint_least32_t size, uint_least32_t stop, uint_least32_t &samples) {
+    samples = 0;
+
+    if (m_abort) {
+        setError("Aborted");
+        return false;
+    }
+
+    const uint_least32_t current = timeMs();
+    if (m_finished || (current >= stop))
+        return true;
+
+    const uint_least32_t samplesPerSecond = m_engCfg.frequency * m_channels;
+
+    uint_least64_t remaining = ((uint_least64_t)(stop - current) * samplesPerSecond) / 1000;
+    remaining -= remaining % m_channels;
+    if (remaining == 0)
+        return true;
+
+    const uint_least32_t length = (remaining < size) ? (uint_least32_t)remaining : size;
+    samples = m_engine.play(buffer, length);
+    if (samples < length) {
+        if (m_engine.isPlaying()) {
+            setError(m_engine.error());
+            return false;
+        }
+        m_finished = true;
+    }
+    return true;
+}
+
+bool Renderer::render(unsigned int song, const std::string &outBase, uint_least32_t stop, bool detectEnd) {
+    m_endTime = 0;
+    if (!setup(song))
+        return false;
+
+    const SidTuneInfo *tuneInfo = m_tune.getInfo();
+
+    std::string name(outBase);
+    if (tuneInfo->songs() > 1) {
+        std::ostringstream sstream;
+        sstream << "[" << tuneInfo->currentSong() << "]";
+        name.append(sstream.str());
+    }
+
+    std::unique_ptr<IAudio> sink(createOutput(tuneInfo, name));
+    if (!sink.get())
+        return false;
+
+    AudioConfig cfg;
+    cfg.frequency = m_settings.engCfg.frequency;
+    cfg.channels  = m_settings.channels ? m_settings.channels : ((tuneInfo->sidChips() > 1) ? 2 : 1);
+    cfg.precision = m_settings.precision;
+    cfg.bufSize   = 0;
+    cfg.length    = stop - m_settings.start;
+
+    if (!sink->open(cfg)) {
+        setError(sink->getErrorString());
+        return false;
+    }
+
+    if (!configure(cfg))
+        return false;
+
+    short *buffer = sink->buffer();
+    const uint_least32_t bufSize = cfg.bufSize;
+
+    // Fast forward to the start position without output
+    if (m_settings.start && !seek(m_settings.start, buffer, bufSize))
+        return false;
+
+    SilenceDetector detector;
+    detectEnd = detectEnd && m_settings.detectEnd
+        && detector.setup(cfg.frequency, cfg.channels, m_settings.silenceThreshold, m_settings.silenceHold);
+
+    for (;;) {
+        uint_least32_t samples;
+        if (!play(buffer, bufSize, stop, samples))
+            return false;
+        if (!samples)
+            break;
+        // Check before writing, the sink may reuse the buffer
+        const bool ended = detectEnd && detector.process(buffer, samples / cfg.channels);
+        if (!sink->write(samples)) {
+            setError(sink->getErrorString());
+            return false;
+        }
+        if (ended) {
+            m_endTime = m_settings.start + (uint_least32_t)(detector.endFrame() * 1000 / cfg.frequency);
+            break;
+        }
+    }
+
+    m_engine.stop();
+    sink->close();
+
+    // Data still in flight is written on close
+    if (*sink->getErrorString()) {
+        setError(sink->getErrorString());
+        return false;
+    }
+    return true;
+}
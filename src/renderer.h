@@ -0,0 +1,191 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include <sidplayfp/SidTune.h>
+#include <sidplayfp/sidplayfp.h>
+#include <sidplayfp/SidConfig.h>
+#include <sidplayfp/SidTuneInfo.h>
+#include <sidplayfp/SidDatabase.h>
+
+#include "player.h"
+#include "songlength.h"
+#include "md5cache.h"
+
+class IAudio;
+class AudioConfig;
+
+// Get the MD5 of a tune in the flavour used by the songlength DB,
+// going through the cache if there's one
+void tuneMD5(SidTune &tune, const std::string &file, bool newSonglengthDB, Md5Cache *cache, char *md5);
+
+// Extension of the files written by an output type
+const char *outputExtension(OUTPUTS output);
+
+// Create a file sink for an output type, tags are added if info is set.
+// With loudness set the output is measured, see Audio_Loudness.
+// Throws std::bad_alloc
+IAudio *createFileOutput(OUTPUTS output, const std::string &name, const SidTuneInfo *tuneInfo, bool info, bool loudness);
+
+// Wrap a file sink so that the same render is also written at the
+// given rates, to files named after it, e.g. tune.96000.wav.
+// Takes ownership of the sink. Throws std::bad_alloc
+IAudio *createRateOutputs(IAudio *sink, OUTPUTS output, const std::string &name, const SidTuneInfo *tuneInfo,
+                          bool info, bool loudness, const std::vector<unsigned int> &rates);
+
+/*
+ * Settings shared by all the renderers of a batch.
+ * Everything here is read-only once the workers are started,
+ * except for the database which must be accessed
+ * with databaseLock held.
+ */
+struct renderSettings {
+    SidConfig      engCfg;      // sidEmulation and playback are set per renderer
+    SIDEMUS        sid;
+    OUTPUTS        output;
+    bool           info;        // add metadata to wav, flac and opus files
+    bool           loudness;    // measure the loudness of the files
+    int            channels;    // 0 = selected by tune
+    int            precision;
+    std::vector<unsigned int> rates; // extra sample rates, resampled
+
+    bool           detectEnd;   // end songs of unknown length on silence
+    double         silenceThreshold; // dBFS
+    uint_least32_t silenceHold; // ms
+
+    bool           filter;
+    double         bias;
+    double         filterCurve6581;
+    double         filterCurve8580;
+
+    bool           mute[9];
+
+    bool           single;      // render only the first song
+    unsigned int   first;       // 0 = start song
+
+    uint_least32_t start;       // ms
+    uint_least32_t length;      // ms
+    bool           lengthValid; // length provided by the user
+    uint_least32_t defaultLength;
+    uint_least32_t warmup;      // full synthesis before the start, ms
+
+    const uint8_t *kernalRom;
+    const uint8_t *basicRom;
+    const uint8_t *chargenRom;
+
+    const SonglengthIndex *songlengths; // used instead of database if not null
+    SidDatabase   *database;    // may be null
+    bool           newSonglengthDB;
+    mutable std::mutex databaseLock;
+
+    const char    *hvscBase;    // may be null
+
+    Md5Cache      *md5Cache;    // may be null
+
+    // Get the MD5 used by the songlength DB
+    void tuneMD5(SidTune &tune, const std::string &file, char *md5) const
+    {
+        ::tuneMD5(tune, file, newSonglengthDB, md5Cache, md5);
+    }
+
+    // Get the play length of a song from the songlength DB
+    int_least32_t songLength(const char *md5, unsigned int song) const;
+
+    // Compute the stop time of a song, 0 if start time exceeds song length
+    uint_least32_t stopTime(int_least32_t dbLength) const;
+};
+
+/*
+ * Headless tune renderer.
+ * Each instance owns its own engine and SID builder
+ * so that several of them can run in parallel.
+ */
+class Renderer {
+private:
+    const renderSettings    &m_settings;
+    const std::atomic<bool> &m_abort;
+
+    sidplayfp   m_engine;
+    SidConfig   m_engCfg;
+    SidTune     m_tune;
+    std::string m_filename;
+
+    unsigned int m_channels;
+    bool         m_finished;
+    bool         m_mute[9];
+
+    uint_least32_t m_endTime;
+
+    std::string m_error;
+
+private:
+    bool createSidEmu();
+    IAudio *createOutput(const SidTuneInfo *tuneInfo, const std::string &name);
+
+    void setError(const char *msg) { m_error.assign(msg); }
+
+public:
+    Renderer(const renderSettings &settings, const std::atomic<bool> &abort);
+    ~Renderer();
+
+    // Load a tune, prepending HVSC_BASE if needed
+    static bool loadTune(SidTune &tune, const std::string &filename, const char *hvscBase);
+
+    bool load(const std::string &filename);
+
+    // Override the voices muted in the settings, before configure()
+    void mute(unsigned int voice, bool enable) { m_mute[voice] = enable; }
+
+    // Render a single song of the loaded tune to <outBase>[n].<ext>
+    // stopping at the given time in milliseconds, or earlier
+    // when detectEnd is set and the music fades out
+    bool render(unsigned int song, const std::string &outBase, uint_least32_t stop, bool detectEnd = false);
+
+    // Where the last render detected the end of the music, 0 if it didn't
+    uint_least32_t endTime() const { return m_endTime; }
+
+    // Low level interface, used to render to something other than a file:
+    // setup() and configure() prepare the engine, seek() silently
+    // runs it up to the given time, without the filter until the
+    // warm-up before it, and play() renders until stop,
+    // returning no samples once done
+    bool setup(unsigned int song);
+    bool configure(const AudioConfig &cfg);
+    bool seek(uint_least32_t time, short *buffer, uint_least32_t size);
+    bool play(short *buffer, uint_least32_t size, uint_least32_t stop, uint_least32_t &samples);
+    void stop() { m_engine.stop(); }
+
+    uint_least32_t timeMs() const;
+
+    // Last values written to the registers of a SID chip,
+    // false if there's no such chip
+    bool sidStatus(unsigned int chip, uint8_t regs[32]);
+
+    const char *error() const { return m_error.c_str(); }
+};
+
+#endif // RENDERER_H
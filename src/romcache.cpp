@@ -0,0 +1,138 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "romcache.h"
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <fstream>
+
+#if !defined _WIN32 && defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+#include "utils.h"
+
+#include "sidcxx11.h"
+
+namespace {
+
+const TCHAR *romNames[RomCache::ROMS] = { TEXT("kernal"), TEXT("basic"), TEXT("chargen") };
+
+struct knownRom_t {
+    RomCache::rom_t rom;
+    uint32_t        crc;
+    const char     *name;
+};
+
+const knownRom_t knownRoms[] = {
+    { RomCache::KERNAL,  0xdbe3e7c7, "C64 KERNAL 901227-03" },
+    { RomCache::KERNAL,  0xa5c687b3, "C64 KERNAL 901227-02" },
+    { RomCache::KERNAL,  0xdce782fa, "C64 KERNAL 901227-01" },
+    { RomCache::BASIC,   0xf833d117, "C64 BASIC V2 901226-01" },
+    { RomCache::CHARGEN, 0xec4272ee, "C64 character generator 901225-01" },
+};
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+}
+
+bool RomCache::open(image_t &image, const SID_STRING &path, size_t size) {
+#if defined(_WIN32) && defined(UNICODE)
+    SID_IFSTREAM is(path.c_str(), std::ios::binary);
+    if (!is.is_open())
+        return false;
+
+    image.buffer.resize(size);
+    is.read((char*)&image.buffer[0], size);
+    if (is.fail()) {
+        image.buffer.clear();
+        return false;
+    }
+    image.data = &image.buffer[0];
+#else
+    if (!image.file.open(path))
+        return false;
+
+    if (image.file.size() < size) {
+        image.file.close();
+        return false;
+    }
+    image.data = image.file.data();
+#endif
+    image.crc = crc32(image.data, size);
+    return true;
+}
+
+const uint8_t *RomCache::load(rom_t rom, const SID_STRING &path) {
+    image_t &image = m_images[rom];
+    const size_t romSize = size(rom);
+
+    // Try to load given rom
+    if (!path.empty() && open(image, path, romSize))
+        return image.data;
+
+    // Fallback to default rom path
+    try {
+#ifdef _WIN32
+        {
+            // Try exec dir first
+            SID_STRING execPath(utils::getExecPath());
+            execPath.append(SEPARATOR).append(romNames[rom]);
+            if (open(image, execPath, romSize))
+                return image.data;
+        }
+#endif
+        SID_STRING dataPath(utils::getDataPath());
+
+        dataPath.append(SEPARATOR).append(TEXT("sidplayfp")).append(SEPARATOR).append(romNames[rom]);
+#if !defined _WIN32 && defined HAVE_UNISTD_H
+        if (::access(dataPath.c_str(), R_OK) != 0) {
+            dataPath = PKGDATADIR;
+            dataPath.append(romNames[rom]);
+        }
+#endif
+        if (open(image, dataPath, romSize))
+            return image.data;
+    }
+    catch (utils::error const &e) {}
+
+    return nullptr;
+}
+
+const char *RomCache::identify(rom_t rom) const {
+    if (!m_images[rom].data)
+        return nullptr;
+
+    for (size_t i = 0; i < sizeof(knownRoms) / sizeof(knownRoms[0]); i++) {
+        if ((knownRoms[i].rom == rom) && (knownRoms[i].crc == m_images[rom].crc))
+            return knownRoms[i].name;
+    }
+    return nullptr;
+}
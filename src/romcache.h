@@ -0,0 +1,71 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef ROMCACHE_H
+#define ROMCACHE_H
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "mappedfile.h"
+#include "ini/types.h"
+
+/*
+ * C64 ROM images, memory mapped once and shared by all
+ * the engines in the process, and by the processes
+ * mapping the same files, instead of being read into
+ * a private buffer each time.
+ * Images are identified by their CRC32.
+ */
+class RomCache {
+public:
+    enum rom_t { KERNAL, BASIC, CHARGEN, ROMS };
+
+private:
+    struct image_t {
+        MappedFile           file;
+        std::vector<uint8_t> buffer; // wide-char paths are read instead
+        const uint8_t       *data;
+        uint32_t             crc;
+
+        image_t() : data(nullptr), crc(0) {}
+    };
+
+private:
+    image_t m_images[ROMS];
+
+private:
+    bool open(image_t &image, const SID_STRING &path, size_t size);
+
+public:
+    // Map a ROM image, trying the default locations
+    // if path is empty or not a valid image
+    const uint8_t *load(rom_t rom, const SID_STRING &path);
+
+    const uint8_t *get(rom_t rom) const { return m_images[rom].data; }
+    uint32_t crc(rom_t rom) const { return m_images[rom].crc; }
+
+    // Name of a known image, null if the checksum is not recognised
+    const char *identify(rom_t rom) const;
+
+    static size_t size(rom_t rom) { return (rom == CHARGEN) ? 4096 : 8192; }
+};
+
+#endif // ROMCACHE_H
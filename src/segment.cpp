@@ -0,0 +1,334 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "segment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+#include <climits>
+#include <cstdlib>
+
+#include <sys/types.h>
+
+using std::cerr;
+using std::endl;
+
+#include "player.h"
+#include "audio/IAudio.h"
+
+#include "sidcxx11.h"
+
+// Time span searched around the expected splice point, in ms
+const uint_least32_t SEARCH_MARGIN = 50;
+
+// Largest sample difference accepted in the overlap region
+const int MAX_DIFFERENCE = 16;
+
+// Segments shorter than this are not worth an engine
+const uint_least32_t MIN_SEGMENT = 1000;
+
+SegmentRenderer::SegmentRenderer(const renderSettings &settings, unsigned int quietLevel) :
+    m_settings(settings),
+    m_quietLevel(quietLevel),
+    m_song(0),
+    m_abort(false) {}
+
+void SegmentRenderer::clear() {
+    for (std::vector<segment_t>::iterator it = m_segments.begin(); it != m_segments.end(); ++it) {
+        if (it->file)
+            std::fclose(it->file);
+    }
+    m_segments.clear();
+}
+
+// Render a segment to a temporary file
+void SegmentRenderer::worker(size_t n) {
+    segment_t &segment = m_segments[n];
+
+    segment.file = std::tmpfile();
+    if (!segment.file) {
+        segment.error = "ERROR: cannot create temporary file";
+        return;
+    }
+
+    Renderer renderer(m_settings, m_abort);
+    if (!renderer.load(m_filename) || !renderer.setup(m_song) || !renderer.configure(m_cfg)) {
+        segment.error = renderer.error();
+        return;
+    }
+
+    std::vector<short> buffer(m_cfg.bufSize);
+    const uint_least32_t bufSize = buffer.size();
+
+    if (segment.from && !renderer.seek(segment.from, &buffer[0], bufSize)) {
+        segment.error = renderer.error();
+        return;
+    }
+    segment.position = renderer.timeMs();
+
+    for (;;) {
+        uint_least32_t samples;
+        if (!renderer.play(&buffer[0], bufSize, segment.to, samples)) {
+            segment.error = renderer.error();
+            return;
+        }
+        if (!samples)
+            break;
+
+        if (std::fwrite(&buffer[0], sizeof(short), samples, segment.file) != samples) {
+            segment.error = "ERROR: cannot write temporary file";
+            return;
+        }
+        segment.frames += samples / m_cfg.channels;
+    }
+
+    renderer.stop();
+    segment.ok = true;
+}
+
+// Temporary files of long renders go past 2 GiB,
+// beyond what fseek can reach where long is 32 bit
+bool SegmentRenderer::seekFrame(std::FILE *file, uint_least64_t frame) {
+    const uint_least64_t offset = frame * m_cfg.channels * sizeof(short);
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#elif defined(HAVE_FSEEKO)
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#else
+    return (offset <= LONG_MAX) && (std::fseek(file, (long)offset, SEEK_SET) == 0);
+#endif
+}
+
+bool SegmentRenderer::readFrames(const segment_t &segment, uint_least64_t first, uint_least64_t count, std::vector<short> &frames) {
+    const size_t samples = count * m_cfg.channels;
+    frames.resize(samples);
+
+    return seekFrame(segment.file, first)
+        && (std::fread(&frames[0], sizeof(short), samples, segment.file) == samples);
+}
+
+// Find where the end of the previous segment falls into
+// the pre-roll of segment n and check that they match
+bool SegmentRenderer::splice(size_t n, uint_least64_t &skip) {
+    const segment_t &prev = m_segments[n - 1];
+    const segment_t &cur  = m_segments[n];
+
+    const int_least64_t freq     = m_cfg.frequency;
+    const unsigned int  channels = m_cfg.channels;
+
+    // Frames compared, half of the pre-roll
+    const int_least64_t window = ((int_least64_t)(prev.to - cur.from) * freq / 1000) / 2;
+    const int_least64_t margin = (int_least64_t)SEARCH_MARGIN * freq / 1000;
+
+    // Index of the last frame of the previous segment
+    // in the current one, from the engine clocks
+    const int_least64_t prevEnd  = (int_least64_t)prev.position * freq / 1000 + (int_least64_t)prev.frames;
+    const int_least64_t expected = prevEnd - (int_least64_t)cur.position * freq / 1000 - 1;
+
+    const int_least64_t lo = std::max(window - 1, expected - margin);
+    const int_least64_t hi = std::min((int_least64_t)cur.frames - 1, expected + margin);
+    if ((window <= 0) || ((int_least64_t)prev.frames < window) || (lo > hi)) {
+        cerr << "ERROR: segment " << n << " does not overlap the previous one, increase the pre-roll" << endl;
+        return false;
+    }
+
+    std::vector<short> tail, head;
+    if (!readFrames(prev, prev.frames - window, window, tail)
+        || !readFrames(cur, lo - window + 1, hi - lo + window, head)) {
+        cerr << "ERROR: cannot read temporary file" << endl;
+        return false;
+    }
+
+    // Search outwards from the expected position so that
+    // on a tie, e.g. silence, the nearest one wins
+    const size_t samples = window * channels;
+    int_least64_t best     = -1;
+    uint_least64_t bestSum = 0;
+    for (int_least64_t d = 0; (d <= margin) && (bestSum || (best < 0)); d++) {
+        for (int side = 0; side < 2; side++) {
+            const int_least64_t o = side ? expected + d : expected - d;
+            if ((o < lo) || (o > hi) || (side && !d))
+                continue;
+
+            const short *data = &head[(o - lo) * channels];
+            uint_least64_t sum = 0;
+            for (size_t i = 0; i < samples; i++) {
+                sum += std::abs(tail[i] - data[i]);
+                if ((best >= 0) && (sum >= bestSum))
+                    break;
+            }
+            if ((best < 0) || (sum < bestSum)) {
+                best    = o;
+                bestSum = sum;
+            }
+        }
+    }
+
+    int maxDiff = 0;
+    const short *data = &head[(best - lo) * channels];
+    for (size_t i = 0; i < samples; i++)
+        maxDiff = std::max(maxDiff, std::abs(tail[i] - data[i]));
+
+    if (maxDiff > MAX_DIFFERENCE) {
+        cerr << "WARNING: segment " << n << " differs from the previous one by up to "
+             << maxDiff << " in the overlap region" << endl;
+    }
+    else if (m_quietLevel < 1 && (best != expected)) {
+        cerr << "Segment " << n << " spliced " << (best - expected) << " frames off the expected position" << endl;
+    }
+
+    skip = best + 1;
+    return true;
+}
+
+bool SegmentRenderer::write(const segment_t &segment, uint_least64_t skip, IAudio *sink) {
+    if (!seekFrame(segment.file, skip))
+        return false;
+
+    short *buffer = sink->buffer();
+    const size_t bufSize = m_cfg.bufSize - (m_cfg.bufSize % m_cfg.channels);
+
+    for (;;) {
+        const size_t samples = std::fread(buffer, sizeof(short), bufSize, segment.file);
+        if (samples && !sink->write(samples))
+            return false;
+        if (samples < bufSize)
+            return !std::ferror(segment.file);
+    }
+}
+
+bool SegmentRenderer::render(const std::string &filename, unsigned int song, uint_least32_t stop,
+                             unsigned int segments, uint_least32_t preroll,
+                             IAudio *sink, const AudioConfig &cfg) {
+    clear();
+
+    m_filename = filename;
+    m_song     = song;
+    m_cfg      = cfg;
+
+    const uint_least32_t start  = m_settings.start;
+    const uint_least32_t length = stop - start;
+
+    if (segments > length / MIN_SEGMENT)
+        segments = length / MIN_SEGMENT;
+    if (segments == 0)
+        segments = 1;
+
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    m_segments.resize(segments);
+    for (unsigned int i = 0; i < segments; i++) {
+        segment_t &segment = m_segments[i];
+        const uint_least32_t from = start + (uint_least32_t)(((uint_least64_t)length * i) / segments);
+        segment.from = (i == 0) ? start : ((from > preroll) ? from - preroll : 0);
+        segment.to   = start + (uint_least32_t)(((uint_least64_t)length * (i + 1)) / segments);
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < segments; i++)
+        workers.push_back(std::thread(&SegmentRenderer::worker, this, (size_t)i));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    for (std::vector<segment_t>::const_iterator it = m_segments.begin(); it != m_segments.end(); ++it) {
+        if (!it->ok) {
+            if (!m_abort)
+                cerr << it->error << endl;
+            return false;
+        }
+    }
+
+    // Join the pieces
+    for (size_t i = 0; i < m_segments.size(); i++) {
+        uint_least64_t skip = 0;
+        if ((i > 0) && !splice(i, skip))
+            return false;
+        if (!write(m_segments[i], skip, sink)) {
+            if (*sink->getErrorString())
+                cerr << sink->getErrorString() << endl;
+            else
+                cerr << "ERROR: cannot read temporary file" << endl;
+            return false;
+        }
+    }
+
+    clear();
+
+    if (m_quietLevel < 2) {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        cerr << "Rendered song " << song << " in " << segments << " segment" << ((segments != 1) ? "s" : "")
+             << " in " << std::fixed << std::setprecision(1) << elapsed.count() << 's' << endl;
+    }
+
+    return true;
+}
+
+// Segmented rendering entry point
+bool ConsolePlayer::renderSegments() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    if (!settings.lengthValid)
+        settings.tuneMD5(m_tune, m_filename, md5);
+
+    const SidTuneInfo *tuneInfo = m_tune.getInfo();
+    const unsigned int songs = m_track.single ? 1 : tuneInfo->songs();
+
+    SegmentRenderer renderer(settings, m_quietLevel);
+    m_segmentRenderer = &renderer;
+
+    bool ret = true;
+    unsigned int song = m_track.first;
+    for (unsigned int i = 0; ret && (i < songs); i++) {
+        m_tune.selectSong(song);
+
+        const uint_least32_t stop = settings.stopTime(settings.lengthValid ? -1 : settings.songLength(md5, song));
+        if (!stop) {
+            displayError("ERROR: start time exceeds song length!");
+            ret = false;
+            break;
+        }
+
+        if (!createOutput(m_driver.output, tuneInfo, stop - settings.start)) {
+            ret = false;
+            break;
+        }
+
+        ret = renderer.render(m_filename, song, stop, m_batch.segments, m_batch.preroll,
+                              m_driver.device, m_driver.cfg);
+        m_driver.device->close();
+        if (ret && *m_driver.device->getErrorString()) {
+            displayError(m_driver.device->getErrorString());
+            ret = false;
+        }
+
+        if (++song > tuneInfo->songs())
+            song = 1;
+    }
+
+    m_segmentRenderer = nullptr;
+    createOutput(OUT_NULL, nullptr);
+    return ret;
+}
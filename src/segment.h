@@ -0,0 +1,97 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+
+#include "renderer.h"
+#include "audio/AudioConfig.h"
+
+class IAudio;
+
+/*
+ * Renders a single song split in time segments,
+ * each one on its own engine.
+ *
+ * Every segment but the first starts a pre-roll before
+ * its nominal start, so its output overlaps the end
+ * of the previous segment. The overlap is used to find
+ * the exact splice point and to check that the two
+ * engines agree before the pieces are joined.
+ */
+class SegmentRenderer {
+private:
+    struct segment_t {
+        uint_least32_t from;     // ms, including pre-roll
+        uint_least32_t to;       // ms
+        uint_least32_t position; // actual start of the rendered data in ms
+        uint_least64_t frames;   // rendered frames
+        std::FILE     *file;     // rendered data
+        bool           ok;
+        std::string    error;
+
+        segment_t() : from(0), to(0), position(0), frames(0), file(nullptr), ok(false) {}
+    };
+
+private:
+    const renderSettings &m_settings;
+    const unsigned int    m_quietLevel;
+
+    std::vector<segment_t> m_segments;
+
+    AudioConfig      m_cfg;
+    std::string      m_filename;
+    unsigned int     m_song;
+
+    std::atomic<bool> m_abort;
+
+private:
+    void worker(size_t n);
+
+    bool seekFrame(std::FILE *file, uint_least64_t frame);
+    bool readFrames(const segment_t &segment, uint_least64_t first, uint_least64_t count, std::vector<short> &frames);
+    bool splice(size_t n, uint_least64_t &skip);
+    bool write(const segment_t &segment, uint_least64_t skip, IAudio *sink);
+
+    void clear();
+
+public:
+    SegmentRenderer(const renderSettings &settings, unsigned int quietLevel);
+    ~SegmentRenderer() { clear(); }
+
+    // Render song from start to stop time (ms) into an already opened sink
+    bool render(const std::string &filename, unsigned int song, uint_least32_t stop,
+                unsigned int segments, uint_least32_t preroll,
+                IAudio *sink, const AudioConfig &cfg);
+
+    // Can be called from a signal handler
+    void stop() { m_abort = true; }
+};
+
+#endif // SEGMENT_H
@@ -0,0 +1,325 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include "songlength.h"
+
+#include <fstream>
+#include <sstream>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "fileutils.h"
+
+#include "sidcxx11.h"
+
+const char     INDEX_MAGIC[4] = { 'S', 'L', 'I', 'X' };
+const uint32_t INDEX_VERSION  = 1;
+const uint32_t INDEX_ENDIAN   = 0x01020304;
+
+const unsigned int MD5_SIZE = 16;
+
+struct SonglengthIndex::header_t {
+    char     magic[4];
+    uint32_t version;
+    uint64_t mtime;     // of the text database
+    uint64_t size;      // of the text database
+    uint32_t slots;     // hash table size, a power of two
+    uint32_t entries;
+    uint32_t lengths;   // number of song lengths
+    uint32_t endian;
+};
+
+struct SonglengthIndex::slot_t {
+    uint8_t  md5[MD5_SIZE];
+    uint32_t offset;    // first song length
+    uint32_t songs;     // 0 = empty slot
+};
+
+namespace {
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool parseMD5(const char *str, uint8_t *md5) {
+    for (unsigned int i = 0; i < MD5_SIZE; i++) {
+        const int hi = hexDigit(str[i * 2]);
+        const int lo = hexDigit(str[i * 2 + 1]);
+        if ((hi < 0) || (lo < 0))
+            return false;
+        md5[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// The MD5 is already well distributed, use its first bytes
+uint32_t hash(const uint8_t *md5) {
+    return md5[0] | (md5[1] << 8) | (md5[2] << 16) | ((uint32_t)md5[3] << 24);
+}
+
+// Parse a time in m:ss[.SSS] format, with an optional
+// attribute in parenthesis as found in old databases
+bool parseLength(const std::string &token, uint32_t &ms) {
+    const char *str = token.c_str();
+    char *end;
+
+    const unsigned long minutes = strtoul(str, &end, 10);
+    if ((end == str) || (*end != ':'))
+        return false;
+
+    str = end + 1;
+    const unsigned long seconds = strtoul(str, &end, 10);
+    if ((end == str) || (seconds > 59))
+        return false;
+
+    unsigned long milliseconds = 0;
+    if (*end == '.') {
+        str = end + 1;
+        milliseconds = strtoul(str, &end, 10);
+        switch (end - str) {
+        case 1: milliseconds *= 100; break;
+        case 2: milliseconds *= 10; break;
+        case 3: break;
+        default: return false;
+        }
+    }
+
+    if ((*end != '\0') && (*end != '('))
+        return false;
+
+    ms = (uint32_t)((minutes * 60 + seconds) * 1000 + milliseconds);
+    return true;
+}
+
+// 64-bit FNV-1a, to name the index after its database
+uint64_t fnv1a(const std::string &str) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+        h ^= (uint8_t)*it;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+}
+
+SonglengthIndex::SonglengthIndex() :
+    m_header(nullptr),
+    m_slots(nullptr),
+    m_lengths(nullptr) {}
+
+void SonglengthIndex::close() {
+    m_file.close();
+    m_memory.clear();
+    m_header  = nullptr;
+    m_slots   = nullptr;
+    m_lengths = nullptr;
+}
+
+// Validate an index image and point into it
+bool SonglengthIndex::attach(const uint8_t *data, size_t size, uint64_t mtime, uint64_t fileSize) {
+    if (size < sizeof(header_t))
+        return false;
+
+    const header_t *header = reinterpret_cast<const header_t*>(data);
+    if ((memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        || (header->version != INDEX_VERSION)
+        || (header->endian != INDEX_ENDIAN)
+        || (header->mtime != mtime)
+        || (header->size != fileSize)
+        || (header->slots == 0)
+        || (header->slots & (header->slots - 1)))
+        return false;
+
+    const uint64_t expected = sizeof(header_t)
+        + (uint64_t)header->slots * sizeof(slot_t)
+        + (uint64_t)header->lengths * sizeof(uint32_t);
+    if (size != expected)
+        return false;
+
+    m_header  = header;
+    m_slots   = reinterpret_cast<const slot_t*>(data + sizeof(header_t));
+    m_lengths = reinterpret_cast<const uint32_t*>(data + sizeof(header_t) + header->slots * sizeof(slot_t));
+    return true;
+}
+
+bool SonglengthIndex::build(const std::string &database, const std::string &indexPath, uint64_t mtime, uint64_t fileSize) {
+    std::ifstream in(database.c_str());
+    if (!in.is_open()) {
+        m_error = "SONGLENGTH DATABASE ERROR: Unable to load the songlength database";
+        return false;
+    }
+
+    struct entry_t {
+        uint8_t  md5[MD5_SIZE];
+        uint32_t offset;
+        uint32_t songs;
+    };
+
+    std::vector<entry_t>  entries;
+    std::vector<uint32_t> lengths;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.length() - 1] == '\r')
+            line.erase(line.length() - 1);
+
+        // Skip comments, section names and anything else
+        if ((line.length() <= MD5_SIZE * 2) || (line[MD5_SIZE * 2] != '='))
+            continue;
+
+        entry_t entry;
+        if (!parseMD5(line.c_str(), entry.md5))
+            continue;
+
+        entry.offset = lengths.size();
+
+        std::istringstream times(line.substr(MD5_SIZE * 2 + 1));
+        std::string token;
+        while (times >> token) {
+            uint32_t ms;
+            if (!parseLength(token, ms))
+                break;
+            lengths.push_back(ms);
+        }
+
+        entry.songs = lengths.size() - entry.offset;
+        if (entry.songs)
+            entries.push_back(entry);
+    }
+
+    // Keep the table at most half full
+    uint32_t slots = 1;
+    while (slots < entries.size() * 2)
+        slots <<= 1;
+
+    std::vector<uint8_t> image(sizeof(header_t) + slots * sizeof(slot_t) + lengths.size() * sizeof(uint32_t), 0);
+
+    header_t *header = reinterpret_cast<header_t*>(&image[0]);
+    memcpy(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header->version = INDEX_VERSION;
+    header->mtime   = mtime;
+    header->size    = fileSize;
+    header->slots   = slots;
+    header->entries = entries.size();
+    header->lengths = lengths.size();
+    header->endian  = INDEX_ENDIAN;
+
+    slot_t *table = reinterpret_cast<slot_t*>(&image[sizeof(header_t)]);
+    for (std::vector<entry_t>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        uint32_t i = hash(it->md5) & (slots - 1);
+        while (table[i].songs && memcmp(table[i].md5, it->md5, MD5_SIZE))
+            i = (i + 1) & (slots - 1);
+        if (table[i].songs)
+            continue; // duplicate, first one wins
+
+        memcpy(table[i].md5, it->md5, MD5_SIZE);
+        table[i].offset = it->offset;
+        table[i].songs  = it->songs;
+    }
+
+    if (!lengths.empty())
+        memcpy(&image[sizeof(header_t) + slots * sizeof(slot_t)], &lengths[0], lengths.size() * sizeof(uint32_t));
+
+    // Save it under a temporary name and rename it in place
+    // so that concurrent processes never see a partial index
+    std::ostringstream tmpPath;
+#ifdef _WIN32
+    tmpPath << indexPath << '.' << GetCurrentProcessId();
+#else
+    tmpPath << indexPath << '.' << getpid();
+#endif
+    bool saved = false;
+    {
+        std::ofstream out(tmpPath.str().c_str(), std::ios::binary);
+        if (out.is_open()) {
+            out.write((const char*)&image[0], image.size());
+            saved = out.good();
+        }
+    }
+#ifdef _WIN32
+    if (saved)
+        std::remove(indexPath.c_str());
+#endif
+    if (saved && (std::rename(tmpPath.str().c_str(), indexPath.c_str()) == 0)
+        && m_file.open(indexPath)
+        && attach(m_file.data(), m_file.size(), mtime, fileSize))
+        return true;
+
+    // Cannot save it, keep it in memory for this run
+    std::remove(tmpPath.str().c_str());
+    m_file.close();
+    m_memory.swap(image);
+    return attach(&m_memory[0], m_memory.size(), mtime, fileSize);
+}
+
+bool SonglengthIndex::open(const std::string &database, const std::string &cacheDir) {
+    close();
+
+    struct stat st;
+    if (stat(database.c_str(), &st) != 0) {
+        m_error = "SONGLENGTH DATABASE ERROR: Unable to load the songlength database";
+        return false;
+    }
+    const uint64_t mtime    = st.st_mtime;
+    const uint64_t fileSize = st.st_size;
+
+    std::ostringstream name;
+    name << "songlengths-" << std::hex << fnv1a(absolutePath(database)) << ".idx";
+    const std::string indexPath(joinPath(cacheDir, name.str()));
+
+    if (m_file.open(indexPath) && attach(m_file.data(), m_file.size(), mtime, fileSize))
+        return true;
+
+    // Missing or stale
+    m_file.close();
+    makePath(cacheDir);
+    return build(database, indexPath, mtime, fileSize);
+}
+
+int_least32_t SonglengthIndex::lengthMs(const char *md5, unsigned int song) const {
+    uint8_t key[MD5_SIZE];
+    if (!m_header || !parseMD5(md5, key))
+        return -1;
+
+    const uint32_t mask = m_header->slots - 1;
+    for (uint32_t i = hash(key) & mask; m_slots[i].songs; i = (i + 1) & mask) {
+        const slot_t &slot = m_slots[i];
+        if (memcmp(slot.md5, key, MD5_SIZE) == 0) {
+            if ((song == 0) || (song > slot.songs))
+                return -1;
+            return m_lengths[slot.offset + song - 1];
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef SONGLENGTH_H
+#define SONGLENGTH_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "mappedfile.h"
+
+/*
+ * Compiled songlength DB.
+ *
+ * The text database is parsed once into a binary hash table
+ * keyed by the tune MD5 and saved in the cache directory;
+ * later runs just map it. The index is rebuilt whenever the
+ * size or modification time of the database changes.
+ * Lookups are lock free and can be done from any thread.
+ */
+class SonglengthIndex {
+private:
+    struct header_t;
+    struct slot_t;
+
+private:
+    MappedFile           m_file;
+    std::vector<uint8_t> m_memory; // used if the index cannot be saved
+
+    const header_t *m_header;
+    const slot_t   *m_slots;
+    const uint32_t *m_lengths;
+
+    std::string m_error;
+
+private:
+    bool attach(const uint8_t *data, size_t size, uint64_t mtime, uint64_t fileSize);
+    bool build(const std::string &database, const std::string &indexPath, uint64_t mtime, uint64_t fileSize);
+
+public:
+    SonglengthIndex();
+
+    // Open the database, using the index in cacheDir if up to date
+    bool open(const std::string &database, const std::string &cacheDir);
+    void close();
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Get the length of a song in milliseconds, -1 if not found
+    int_least32_t lengthMs(const char *md5, unsigned int song) const;
+
+    const char *error() const { return m_error.c_str(); }
+};
+
+#endif // SONGLENGTH_H
@@ -0,0 +1,447 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "spool.h"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifndef _WIN32
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <unistd.h>    /* gethostname, getpid */
+# include <utime.h>
+#else
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/utime.h>
+# include <windows.h>
+#endif
+
+using std::cerr;
+using std::endl;
+
+#include "batch.h"
+#include "fileutils.h"
+
+#include "sidcxx11.h"
+
+namespace {
+
+const char *JOB_EXTENSION = ".job";
+
+// Interval between polls of an idle queue, in seconds
+const uint_least32_t POLL_INTERVAL = 5;
+
+// Update the modification time of a lease
+bool touch(const std::string &path) {
+#ifndef _WIN32
+    return utime(path.c_str(), nullptr) == 0;
+#else
+    return _utime(path.c_str(), nullptr) == 0;
+#endif
+}
+
+bool modificationTime(const std::string &path, time_t &mtime) {
+#ifndef _WIN32
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+#else
+    struct _stat st;
+    if (_stat(path.c_str(), &st) != 0)
+        return false;
+#endif
+    mtime = st.st_mtime;
+    return true;
+}
+
+// Host name and process id, unique among the workers
+std::string ownerName() {
+    char host[256];
+    std::ostringstream owner;
+#ifndef _WIN32
+    if (gethostname(host, sizeof(host)) != 0)
+        strcpy(host, "localhost");
+    host[sizeof(host) - 1] = '\0';
+    owner << host << '.' << getpid();
+#else
+    DWORD size = sizeof(host);
+    if (!GetComputerNameA(host, &size))
+        strcpy(host, "localhost");
+    owner << host << '.' << GetCurrentProcessId();
+#endif
+    std::string name(owner.str());
+    for (std::string::iterator it = name.begin(); it != name.end(); ++it) {
+        if ((*it == '@') || (*it == '/') || (*it == '\\'))
+            *it = '_';
+    }
+    return name;
+}
+
+bool isJob(const std::string &name) {
+    const size_t len = strlen(JOB_EXTENSION);
+    return (name.length() > len) && (name.compare(name.length() - len, len, JOB_EXTENSION) == 0);
+}
+
+}
+
+SpoolWorker::SpoolWorker(const renderSettings &settings, unsigned int quietLevel,
+                         const std::string &spool, uint_least32_t leaseTime) :
+    m_settings(settings),
+    m_quietLevel(quietLevel),
+    m_spool(spool),
+    m_leaseTime(leaseTime),
+    m_owner(ownerName()),
+    m_counter(0),
+    m_abort(false),
+    m_finished(false),
+    m_done(0),
+    m_failed(0) {}
+
+std::string SpoolWorker::path(const char *dir, const std::string &name) const {
+    return joinPath(joinPath(m_spool, dir), name);
+}
+
+bool SpoolWorker::init() {
+    const char *dirs[] = { "tmp", "queue", "active", "done", "failed", nullptr };
+    for (int i = 0; dirs[i]; i++) {
+        const std::string dir(joinPath(m_spool, dirs[i]));
+        if (!makePath(dir)) {
+            cerr << dir << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Jobs are written in the tmp directory first
+// so that workers never see a partial file
+bool SpoolWorker::enqueue(const std::string &file, const std::string &outBase) {
+    std::ostringstream name;
+    name << baseName(file) << '-' << m_owner << '-' << m_counter++ << JOB_EXTENSION;
+
+    std::string jobName(name.str());
+    for (std::string::iterator it = jobName.begin(); it != jobName.end(); ++it) {
+        if (*it == '@')
+            *it = '_';
+    }
+
+    const std::string tmpPath(path("tmp", jobName));
+    {
+        std::ofstream job(tmpPath.c_str());
+        job << "file=" << absolutePath(file) << endl
+            << "output=" << absolutePath(outBase) << endl;
+        if (!job.good()) {
+            cerr << tmpPath << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), path("queue", jobName).c_str()) != 0) {
+        cerr << jobName << ": " << strerror(errno) << endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Try to take a job from the queue
+bool SpoolWorker::claim(std::list<lease_t>::iterator &lease) {
+    std::vector<std::string> entries;
+    if (!listDirectory(path("queue", ""), entries) || entries.empty())
+        return false;
+
+    // Start from a different point on each worker
+    // to avoid everybody racing for the same job
+    const size_t first = (std::hash<std::string>()(m_owner) + m_counter) % entries.size();
+    for (size_t i = 0; i < entries.size(); i++) {
+        const std::string &name = entries[(first + i) % entries.size()];
+        if (!isJob(name))
+            continue;
+
+        std::ostringstream leaseName;
+        leaseName << name << '@' << m_owner << '.' << m_counter++;
+        const std::string leasePath(path("active", leaseName.str()));
+
+        if (std::rename(path("queue", name).c_str(), leasePath.c_str()) != 0)
+            continue; // taken by someone else
+
+        // Renaming keeps the time the job was queued
+        touch(leasePath);
+
+        lease_t newLease;
+        newLease.name     = name;
+        newLease.path     = leasePath;
+        newLease.renderer = nullptr;
+        newLease.lost     = false;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        lease = m_leases.insert(m_leases.end(), newLease);
+        return true;
+    }
+    return false;
+}
+
+void SpoolWorker::release(std::list<lease_t>::iterator lease, bool ok) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const char *dir = ok ? "done" : "failed";
+    if (!ok && m_abort)
+        dir = "queue"; // interrupted, let someone else do it
+
+    if (lease->lost || (std::rename(lease->path.c_str(), path(dir, lease->name).c_str()) != 0)) {
+        cerr << lease->name << ": lease lost, job left to its new owner" << endl;
+    }
+    else if (!m_abort) {
+        if (ok)
+            m_done++;
+        else
+            m_failed++;
+        if (m_quietLevel < 2)
+            cerr << lease->name << ": " << (ok ? "done" : "failed") << endl;
+    }
+
+    m_leases.erase(lease);
+}
+
+// Current time on the file server holding the spool, lease
+// times are set by it and the local clock may be skewed
+bool SpoolWorker::serverTime(time_t &now) const {
+    const std::string probe(path("tmp", m_owner + ".clock"));
+    if (!touch(probe)) {
+        std::ofstream file(probe.c_str());
+        if (!file.good())
+            return false;
+    }
+    return modificationTime(probe, now);
+}
+
+// Move expired leases back to the queue
+bool SpoolWorker::reclaim() {
+    std::vector<std::string> entries;
+    if (!listDirectory(path("active", ""), entries) || entries.empty())
+        return false;
+
+    time_t now;
+    if (!serverTime(now)) {
+        cerr << path("tmp", m_owner + ".clock") << ": " << strerror(errno) << endl;
+        return false;
+    }
+    bool reclaimed = false;
+
+    for (std::vector<std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        const size_t sep = it->find('@');
+        if (sep == std::string::npos)
+            continue;
+
+        const std::string leasePath(path("active", *it));
+        time_t mtime;
+        if (!modificationTime(leasePath, mtime) || (now - mtime <= (time_t)m_leaseTime))
+            continue;
+
+        const std::string name(it->substr(0, sep));
+        if (std::rename(leasePath.c_str(), path("queue", name).c_str()) == 0) {
+            if (m_quietLevel < 2)
+                cerr << name << ": lease " << it->substr(sep + 1) << " expired, job requeued" << endl;
+            reclaimed = true;
+        }
+    }
+    return reclaimed;
+}
+
+// Check if there's still work queued or in progress anywhere
+bool SpoolWorker::pending() {
+    std::vector<std::string> queued, active;
+    listDirectory(path("queue", ""), queued);
+    listDirectory(path("active", ""), active);
+    return !queued.empty() || !active.empty();
+}
+
+void SpoolWorker::process(std::list<lease_t>::iterator lease) {
+    std::string file, outBase;
+    {
+        std::ifstream job(lease->path.c_str());
+        std::string line;
+        while (std::getline(job, line)) {
+            if (!line.empty() && line[line.length() - 1] == '\r')
+                line.erase(line.length() - 1);
+            if (line.compare(0, 5, "file=") == 0)
+                file = line.substr(5);
+            else if (line.compare(0, 7, "output=") == 0)
+                outBase = line.substr(7);
+        }
+    }
+
+    if (file.empty() || outBase.empty()) {
+        cerr << lease->name << ": invalid job file" << endl;
+        release(lease, false);
+        return;
+    }
+
+    const size_t sep = outBase.find_last_of("/\\");
+    if ((sep != std::string::npos) && (sep > 0) && !makePath(outBase.substr(0, sep))) {
+        cerr << outBase.substr(0, sep) << ": " << strerror(errno) << endl;
+        release(lease, false);
+        return;
+    }
+
+    BatchRenderer renderer(m_settings, 3);
+    renderer.addTune(file, outBase);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        lease->renderer = &renderer;
+    }
+
+    const bool ok = renderer.run(1);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        lease->renderer = nullptr;
+    }
+    release(lease, ok);
+}
+
+void SpoolWorker::worker() {
+    while (!m_abort) {
+        std::list<lease_t>::iterator lease;
+        if (claim(lease)) {
+            process(lease);
+            continue;
+        }
+
+        if (reclaim())
+            continue;
+
+        if (!pending())
+            break;
+
+        // Others are still working, their leases may expire
+        for (uint_least32_t i = 0; (i < POLL_INTERVAL) && !m_abort; i++)
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+// Keep our leases alive and propagate stop requests
+void SpoolWorker::renewer() {
+    const uint_least32_t interval = (m_leaseTime > 3) ? m_leaseTime / 3 : 1;
+    uint_least32_t elapsed = 0;
+
+    while (!m_finished) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_abort) {
+            for (std::list<lease_t>::iterator it = m_leases.begin(); it != m_leases.end(); ++it) {
+                if (it->renderer)
+                    it->renderer->stop();
+            }
+        }
+
+        if (++elapsed < interval)
+            continue;
+        elapsed = 0;
+
+        for (std::list<lease_t>::iterator it = m_leases.begin(); it != m_leases.end(); ++it) {
+            if (it->lost || touch(it->path))
+                continue;
+
+            // Someone took over, stop wasting time on it
+            it->lost = true;
+            if (it->renderer)
+                it->renderer->stop();
+        }
+    }
+}
+
+bool SpoolWorker::run(unsigned int threads) {
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+
+    if (m_quietLevel < 2)
+        cerr << "Worker " << m_owner << " rendering from " << m_spool << " using " << threads << " threads" << endl;
+
+    std::thread renewThread(&SpoolWorker::renewer, this);
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; i++)
+        workers.push_back(std::thread(&SpoolWorker::worker, this));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    m_finished = true;
+    renewThread.join();
+
+    std::remove(path("tmp", m_owner + ".clock").c_str());
+
+    if (m_quietLevel < 3) {
+        cerr << "Rendered " << m_done << " jobs";
+        if (m_failed)
+            cerr << " (" << m_failed << " failed)";
+        cerr << endl;
+    }
+
+    return !m_failed && !m_abort;
+}
+
+// Spool entry point
+bool ConsolePlayer::spool() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    SpoolWorker worker(settings, m_quietLevel, m_batch.spool, m_batch.leaseTime);
+    if (!worker.init())
+        return false;
+
+    // Queue the given tunes
+    if (!m_batch.inputs.empty()) {
+        BatchRenderer inputs(settings, m_quietLevel);
+        for (std::vector<std::string>::const_iterator it = m_batch.inputs.begin(); it != m_batch.inputs.end(); ++it) {
+            if (!inputs.addInput(*it, m_batch.outDir))
+                return false;
+        }
+
+        for (size_t i = 0; i < inputs.inputs(); i++) {
+            if (!worker.enqueue(inputs.inputFile(i), inputs.outputBase(i)))
+                return false;
+        }
+
+        if (m_quietLevel < 3)
+            cerr << "Queued " << inputs.inputs() << " jobs in " << m_batch.spool << endl;
+        return true;
+    }
+
+    m_spoolWorker = &worker;
+    const bool ret = worker.run(m_batch.threads);
+    m_spoolWorker = nullptr;
+    return ret;
+}
@@ -0,0 +1,108 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <string>
+#include <list>
+#include <atomic>
+#include <mutex>
+#include <ctime>
+
+#include "renderer.h"
+
+class BatchRenderer;
+
+/*
+ * Render jobs from a spool directory shared by several
+ * processes, possibly on different hosts.
+ *
+ * <spool>/tmp     jobs being queued
+ * <spool>/queue   jobs waiting to be rendered
+ * <spool>/active  leased jobs
+ * <spool>/done    rendered jobs
+ * <spool>/failed  jobs that could not be rendered
+ *
+ * A job is claimed by atomically renaming it into the active
+ * directory with the owner appended to its name. The owner
+ * keeps touching the lease while rendering; leases that are
+ * not renewed for a lease time are moved back to the queue,
+ * so the work of a crashed node is picked up by the others.
+ * Lease times are compared with the clock of the file server,
+ * read from a probe file, as the nodes' clocks may disagree.
+ */
+class SpoolWorker {
+private:
+    struct lease_t {
+        std::string    name;     // job name
+        std::string    path;     // lease file
+        BatchRenderer *renderer;
+        bool           lost;
+    };
+
+private:
+    const renderSettings &m_settings;
+    const unsigned int    m_quietLevel;
+
+    const std::string    m_spool;
+    const uint_least32_t m_leaseTime; // seconds
+    std::string          m_owner;
+
+    std::atomic<unsigned int> m_counter;
+    std::atomic<bool>         m_abort;
+
+    std::mutex              m_lock;
+    std::list<lease_t>      m_leases;
+    std::atomic<bool>       m_finished;
+    unsigned int            m_done;
+    unsigned int            m_failed;
+
+private:
+    std::string path(const char *dir, const std::string &name) const;
+    bool serverTime(time_t &now) const;
+
+    bool claim(std::list<lease_t>::iterator &lease);
+    void release(std::list<lease_t>::iterator lease, bool ok);
+    bool reclaim();
+    bool pending();
+
+    void process(std::list<lease_t>::iterator lease);
+    void worker();
+    void renewer();
+
+public:
+    SpoolWorker(const renderSettings &settings, unsigned int quietLevel,
+                const std::string &spool, uint_least32_t leaseTime);
+
+    // Create the spool directories
+    bool init();
+
+    // Add a job to the queue
+    bool enqueue(const std::string &file, const std::string &outBase);
+
+    // Render jobs until the queue is empty and no leases are left
+    bool run(unsigned int threads);
+
+    // Can be called from a signal handler
+    void stop() { m_abort = true; }
+};
+
+#endif // SPOOL_H
@@ -0,0 +1,476 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "stems.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <new>
+
+#include <cmath>
+#include <cstdlib>
+
+using std::cerr;
+using std::endl;
+
+#include "player.h"
+#include "audio/IAudio.h"
+
+#include "sidcxx11.h"
+
+// Largest accepted difference between the sum of the stems
+// and the mix, in dB relative to the mix
+const double MAX_RESIDUAL = -30.0;
+
+// <name>.v<n>.<ext>
+static std::string stemName(const std::string &mixName, int voice) {
+    std::ostringstream sstream;
+    sstream << ".v" << (voice + 1);
+
+    std::string name(mixName);
+    const size_t dot   = name.find_last_of('.');
+    const size_t slash = name.find_last_of("/\\");
+    if ((dot == std::string::npos) || ((slash != std::string::npos) && (dot < slash)))
+        name.append(sstream.str());
+    else
+        name.insert(dot, sstream.str());
+    return name;
+}
+
+StemRenderer::StemRenderer(const renderSettings &settings, unsigned int quietLevel) :
+    m_settings(settings),
+    m_quietLevel(quietLevel),
+    m_song(0),
+    m_stop(0),
+    m_check(false),
+    m_sink(nullptr),
+    m_gain(1),
+    m_abort(false),
+    m_stopped(false),
+    m_active(0),
+    m_arrived(0),
+    m_leaving(0),
+    m_generation(0),
+    m_energy(0.),
+    m_residual(0.),
+    m_maxDiff(0) {}
+
+void StemRenderer::clear() {
+    for (std::vector<stem_t>::iterator it = m_stems.begin(); it != m_stems.end(); ++it)
+        delete it->sink;
+    m_stems.clear();
+}
+
+// Keep the first error and stop everybody
+void StemRenderer::fail(const char *error) {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_error.empty())
+            m_error = error;
+    }
+    m_abort = true;
+}
+
+// Wait for all the engines to render the current buffer, the last
+// one to arrive checks them against the mix or writes the channels
+void StemRenderer::sync(bool leave) {
+    std::unique_lock<std::mutex> lock(m_lock);
+    const unsigned int generation = m_generation;
+
+    m_arrived++;
+    if (leave)
+        m_leaving++;
+
+    if (m_arrived == m_active) {
+        if (!m_abort) {
+            if (m_sink)
+                interleave();
+            else
+                compare();
+        }
+        m_active  -= m_leaving;
+        m_arrived  = 0;
+        m_leaving  = 0;
+        m_generation++;
+        m_wakeup.notify_all();
+    }
+    else {
+        m_wakeup.wait(lock, [this, generation] { return m_generation != generation; });
+    }
+}
+
+// The mix is the first stem
+void StemRenderer::compare() {
+    const stem_t &mix = m_stems[0];
+    for (uint_least32_t i = 0; i < mix.samples; i++) {
+        int sum = 0;
+        for (size_t n = 1; n < m_stems.size(); n++) {
+            if (i < m_stems[n].samples)
+                sum += m_stems[n].buffer[i];
+        }
+        const int diff = mix.buffer[i] - sum;
+        m_energy   += (double)mix.buffer[i] * mix.buffer[i];
+        m_residual += (double)diff * diff;
+        m_maxDiff   = std::max(m_maxDiff, std::abs(diff));
+    }
+}
+
+// One channel per engine, called with the lock held
+void StemRenderer::interleave() {
+    const size_t channels = m_stems.size();
+
+    uint_least32_t frames = 0;
+    for (std::vector<stem_t>::const_iterator it = m_stems.begin(); it != m_stems.end(); ++it)
+        frames = std::max(frames, it->samples);
+    if (!frames)
+        return;
+
+    short *out = m_sink->buffer();
+    for (uint_least32_t i = 0; i < frames; i++) {
+        for (size_t c = 0; c < channels; c++) {
+            const stem_t &stem = m_stems[c];
+            const int sample = (i < stem.samples) ? stem.buffer[i] * m_gain : 0;
+            *out++ = (short) std::max(-32768, std::min(32767, sample));
+        }
+    }
+
+    if (!m_sink->write(frames * channels)) {
+        if (m_error.empty())
+            m_error = m_sink->getErrorString();
+        m_abort = true;
+    }
+}
+
+void StemRenderer::worker(size_t n) {
+    stem_t &stem = m_stems[n];
+
+    Renderer renderer(m_settings, m_abort);
+    if (stem.voices) {
+        for (unsigned int i = 0; i < 9; i++)
+            renderer.mute(i, !(stem.voices & (1 << i)));
+    }
+
+    bool ok = renderer.load(m_filename) && renderer.setup(m_song) && renderer.configure(m_cfg)
+        && (!m_settings.start || renderer.seek(m_settings.start, stem.sink ? stem.sink->buffer() : &stem.data[0], m_cfg.bufSize));
+    if (!ok)
+        fail(renderer.error());
+
+    // Every engine has to go through sync until it's done,
+    // failing ones included, to keep the others going
+    for (;;) {
+        uint_least32_t samples = 0;
+        stem.buffer = stem.sink ? stem.sink->buffer() : &stem.data[0];
+        if (ok && !renderer.play(stem.buffer, m_cfg.bufSize, m_stop, samples)) {
+            fail(renderer.error());
+            ok = false;
+        }
+        stem.samples = samples;
+
+        const bool done = !ok || m_abort || !samples;
+        if (m_check || m_sink)
+            sync(done);
+        if (done)
+            break;
+
+        if (stem.sink && !stem.sink->write(samples)) {
+            fail(stem.sink->getErrorString());
+            ok = false;
+        }
+    }
+
+    renderer.stop();
+}
+
+bool StemRenderer::render(const std::string &filename, const SidTuneInfo *tuneInfo, unsigned int song,
+                          uint_least32_t stop, const std::string &mixName, bool mix) {
+    clear();
+
+    m_filename = filename;
+    m_song     = song;
+    m_stop     = stop;
+    m_check    = mix;
+    m_sink     = nullptr;
+    m_error.clear();
+
+    const int voices = std::min(9, (int)tuneInfo->sidChips() * 3);
+
+    try {
+        if (mix) {
+            m_stems.push_back(stem_t());
+            m_stems.back().name = mixName;
+        }
+        for (int voice = 0; voice < voices; voice++) {
+            if (m_settings.mute[voice])
+                continue;
+            m_stems.push_back(stem_t());
+            m_stems.back().voices = 1 << voice;
+            m_stems.back().name   = stemName(mixName, voice);
+        }
+    }
+    catch (std::bad_alloc const &ba) {
+        cerr << "ERROR: not enough memory." << endl;
+        return false;
+    }
+
+    const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    AudioConfig cfg;
+    cfg.frequency = m_settings.engCfg.frequency;
+    cfg.channels  = m_settings.channels ? m_settings.channels : ((tuneInfo->sidChips() > 1) ? 2 : 1);
+    cfg.precision = m_settings.precision;
+    cfg.length    = stop - m_settings.start;
+
+    // All the engines render the same amount at a time
+    m_cfg = cfg;
+    m_cfg.bufSize = 0;
+    for (std::vector<stem_t>::iterator it = m_stems.begin(); it != m_stems.end(); ++it) {
+        try {
+            it->sink = createFileOutput(m_settings.output, it->name, tuneInfo, m_settings.info, m_settings.loudness);
+        }
+        catch (std::bad_alloc const &ba) {
+            cerr << "ERROR: not enough memory." << endl;
+            return false;
+        }
+
+        AudioConfig sinkCfg = cfg;
+        sinkCfg.bufSize = 0;
+        if (!it->sink->open(sinkCfg)) {
+            cerr << it->sink->getErrorString() << endl;
+            return false;
+        }
+        if (!m_cfg.bufSize || (sinkCfg.bufSize < m_cfg.bufSize))
+            m_cfg.bufSize = sinkCfg.bufSize;
+    }
+    m_cfg.bufSize -= m_cfg.bufSize % m_cfg.channels;
+
+    m_active     = m_stems.size();
+    m_arrived    = 0;
+    m_leaving    = 0;
+    m_generation = 0;
+    m_energy     = 0.;
+    m_residual   = 0.;
+    m_maxDiff    = 0;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_stems.size(); i++)
+        workers.push_back(std::thread(&StemRenderer::worker, this, i));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    // Data still in flight is written on close
+    for (std::vector<stem_t>::iterator it = m_stems.begin(); it != m_stems.end(); ++it) {
+        it->sink->close();
+        if (m_error.empty() && *it->sink->getErrorString())
+            m_error = it->sink->getErrorString();
+    }
+
+    if (!m_error.empty()) {
+        if (!m_stopped)
+            cerr << m_error << endl;
+        return false;
+    }
+
+    if (m_check && (m_energy > 0.)) {
+        const double level = (m_residual > 0.) ? 10. * std::log10(m_residual / m_energy) : -HUGE_VAL;
+        if (level > MAX_RESIDUAL) {
+            cerr << "WARNING: the stems of song " << song << " differ from the mix by "
+                 << std::fixed << std::setprecision(1) << level << " dB, up to " << m_maxDiff << endl;
+        }
+        else if (m_quietLevel < 1) {
+            cerr << "Stems of song " << song << " match the mix within "
+                 << std::fixed << std::setprecision(1) << level << " dB" << endl;
+        }
+    }
+
+    clear();
+
+    if (m_quietLevel < 2) {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        const size_t stems = m_check ? m_stems.size() - 1 : m_stems.size();
+        cerr << "Rendered song " << song << " in " << stems << " stem" << ((stems != 1) ? "s" : "")
+             << (m_check ? " and the mix" : "") << " in "
+             << std::fixed << std::setprecision(1) << elapsed.count() << 's' << endl;
+    }
+
+    return true;
+}
+
+bool StemRenderer::renderChannels(const std::string &filename, const SidTuneInfo *tuneInfo, unsigned int song,
+                                  uint_least32_t stop, IAudio *sink, const AudioConfig &cfg) {
+    clear();
+
+    m_filename = filename;
+    m_song     = song;
+    m_stop     = stop;
+    m_check    = false;
+    m_sink     = sink;
+    m_error.clear();
+
+    const unsigned int chips = cfg.channels;
+    if ((int)chips != tuneInfo->sidChips()) {
+        cerr << "ERROR: " << chips << " channels for " << tuneInfo->sidChips() << " chips" << endl;
+        return false;
+    }
+
+    // Each engine plays a single chip in mono. The library
+    // divides the mono mix by the number of chips, the
+    // muted ones included, so their level is made up for
+    m_gain = chips;
+    m_cfg = cfg;
+    m_cfg.channels = 1;
+    m_cfg.bufSize  = cfg.bufSize / chips;
+
+    try {
+        for (unsigned int chip = 0; chip < chips; chip++) {
+            m_stems.push_back(stem_t());
+            stem_t &stem = m_stems.back();
+            stem.voices = 7 << (chip * 3);
+            for (unsigned int i = 0; i < 9; i++) {
+                if (m_settings.mute[i])
+                    stem.voices &= ~(1 << i);
+            }
+            stem.data.resize(m_cfg.bufSize);
+        }
+    }
+    catch (std::bad_alloc const &ba) {
+        cerr << "ERROR: not enough memory." << endl;
+        return false;
+    }
+
+    m_active     = m_stems.size();
+    m_arrived    = 0;
+    m_leaving    = 0;
+    m_generation = 0;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < m_stems.size(); i++)
+        workers.push_back(std::thread(&StemRenderer::worker, this, i));
+    for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+        it->join();
+
+    m_sink = nullptr;
+    clear();
+
+    if (!m_error.empty()) {
+        if (!m_stopped)
+            cerr << m_error << endl;
+        return false;
+    }
+    return true;
+}
+
+// Stem rendering entry point
+bool ConsolePlayer::renderStems() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    if (!settings.lengthValid)
+        settings.tuneMD5(m_tune, m_filename, md5);
+
+    const SidTuneInfo *tuneInfo = m_tune.getInfo();
+    const unsigned int songs = m_track.single ? 1 : tuneInfo->songs();
+
+    StemRenderer renderer(settings, m_quietLevel);
+    m_stemRenderer = &renderer;
+
+    bool ret = true;
+    unsigned int song = m_track.first;
+    for (unsigned int i = 0; ret && (i < songs); i++) {
+        m_tune.selectSong(song);
+
+        const uint_least32_t stop = settings.stopTime(settings.lengthValid ? -1 : settings.songLength(md5, song));
+        if (!stop) {
+            displayError("ERROR: start time exceeds song length!");
+            ret = false;
+            break;
+        }
+
+        ret = renderer.render(m_filename, tuneInfo, song, stop,
+                              getFileName(tuneInfo, outputExtension(m_driver.output)), m_batch.stemsMix);
+
+        if (++song > tuneInfo->songs())
+            song = 1;
+    }
+
+    m_stemRenderer = nullptr;
+    return ret;
+}
+
+// Multichannel entry point, for tunes with more chips than stereo can keep apart
+bool ConsolePlayer::renderChannels() {
+    renderSettings settings;
+    renderConfig(settings);
+
+    // Play as long as the player would
+    if (!m_driver.file && m_timer.length)
+        settings.defaultLength = m_timer.length;
+
+    char md5[SidTune::MD5_LENGTH + 1];
+    if (!settings.lengthValid)
+        settings.tuneMD5(m_tune, m_filename, md5);
+
+    const SidTuneInfo *tuneInfo = m_tune.getInfo();
+    const unsigned int songs = m_track.single ? 1 : tuneInfo->songs();
+
+    StemRenderer renderer(settings, m_quietLevel);
+    m_stemRenderer = &renderer;
+
+    bool ret = true;
+    unsigned int song = m_track.first;
+    for (unsigned int i = 0; ret && (i < songs); i++) {
+        m_tune.selectSong(song);
+
+        const uint_least32_t stop = settings.stopTime(settings.lengthValid ? -1 : settings.songLength(md5, song));
+        if (!stop) {
+            displayError("ERROR: start time exceeds song length!");
+            ret = false;
+            break;
+        }
+
+        if (!createOutput(m_driver.output, tuneInfo, stop - settings.start)) {
+            ret = false;
+            break;
+        }
+
+        if (m_quietLevel < 2) {
+            cerr << "Song " << song << ": " << m_driver.cfg.channels << " channels, "
+                 << m_driver.cfg.frequency << " Hz" << endl;
+        }
+
+        ret = renderer.renderChannels(m_filename, tuneInfo, song, stop, m_driver.device, m_driver.cfg);
+        m_driver.device->close();
+        if (ret && *m_driver.device->getErrorString()) {
+            displayError(m_driver.device->getErrorString());
+            ret = false;
+        }
+
+        if (++song > tuneInfo->songs())
+            song = 1;
+    }
+
+    m_stemRenderer = nullptr;
+    createOutput(OUT_NULL, nullptr);
+    return ret;
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of sidplayfp, a console SID player.
+ *
+ * Copyright 2026 red M95
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef STEMS_H
+#define STEMS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "renderer.h"
+#include "audio/AudioConfig.h"
+
+class IAudio;
+
+/*
+ * Renders each voice of a song to its own file,
+ * one engine per voice with all the other voices muted.
+ *
+ * The same lock step engines give a multichannel output
+ * with one channel per SID chip, as the library can only
+ * keep two chips apart, in stereo.
+ *
+ * When the full mix is rendered too the engines run
+ * in lock step, one buffer at a time, and the sum of
+ * the stems is compared against the mix. The SID output
+ * stage and filter are not linear and volume register
+ * samples can't be split per voice, so some residual
+ * is expected; a large one means the stems are not
+ * a faithful split of the mix.
+ */
+class StemRenderer {
+private:
+    struct stem_t {
+        unsigned int   voices;   // mask of the voices played, 0 for all
+        std::string    name;
+        IAudio        *sink;     // null when rendering channels
+        std::vector<short> data; // buffer when there's no sink
+        short         *buffer;   // last rendered buffer
+        uint_least32_t samples;
+
+        stem_t() : voices(0), sink(nullptr), buffer(nullptr), samples(0) {}
+    };
+
+private:
+    const renderSettings &m_settings;
+    const unsigned int    m_quietLevel;
+
+    std::vector<stem_t> m_stems;
+
+    AudioConfig      m_cfg;
+    std::string      m_filename;
+    unsigned int     m_song;
+    uint_least32_t   m_stop;
+    bool             m_check;
+    IAudio          *m_sink;     // multichannel output
+    int              m_gain;     // undoes the mono mix down
+
+    std::atomic<bool> m_abort;
+    std::atomic<bool> m_stopped;
+    std::string       m_error;
+
+    // Lock step
+    std::mutex              m_lock;
+    std::condition_variable m_wakeup;
+    size_t                  m_active;
+    size_t                  m_arrived;
+    size_t                  m_leaving;
+    unsigned int            m_generation;
+
+    // Mix check
+    double m_energy;
+    double m_residual;
+    int    m_maxDiff;
+
+private:
+    void worker(size_t n);
+    void fail(const char *error);
+    void sync(bool leave);
+    void compare();
+    void interleave();
+
+    void clear();
+
+public:
+    StemRenderer(const renderSettings &settings, unsigned int quietLevel);
+    ~StemRenderer() { clear(); }
+
+    // Render the voices of a song, from the start to the stop time (ms),
+    // to files named after mixName, e.g. song.wav gives song.v1.wav.
+    // The full mix is written to mixName too if requested.
+    bool render(const std::string &filename, const SidTuneInfo *tuneInfo, unsigned int song,
+                uint_least32_t stop, const std::string &mixName, bool mix);
+
+    // Render a song with each chip on its own channel of an
+    // already opened sink, cfg.channels must match the chips
+    bool renderChannels(const std::string &filename, const SidTuneInfo *tuneInfo, unsigned int song,
+                        uint_least32_t stop, IAudio *sink, const AudioConfig &cfg);
+
+    // Can be called from a signal handler
+    void stop() { m_stopped = true; m_abort = true; }
+};
+
+#endif // STEMS_H